@@ -0,0 +1,209 @@
+#pragma once
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
+// Offset generators for the storage benchmarks.
+// - FastRng: xoshiro256** seeded through splitmix64; one per thread, no locks,
+//   full 64-bit output (unlike rand()).
+// - AccessPattern: block index stream over [0, blocks) for random, sequential,
+//   strided and zipfian (scrambled hot set) access.
+// - Region helpers: parse "256M" / "4G" / "50%" and size files or block devices.
+
+class FastRng {
+public:
+    explicit FastRng(uint64_t seed = 0)
+    {
+        for (auto& w : s_) w = splitmix64(seed);
+    }
+
+    uint64_t operator()()
+    {
+        const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, n) via multiply-high (Lemire); bias is negligible for n << 2^64.
+    uint64_t below(uint64_t n) { return (uint64_t)(((unsigned __int128)(*this)() * n) >> 64); }
+
+    // Uniform in [0, 1).
+    double unit() { return (double)((*this)() >> 11) * 0x1.0p-53; }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    static uint64_t splitmix64(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t s_[4];
+};
+
+// Zipfian rank generator (Gray et al., same construction as YCSB). Ranks are
+// in [0, n), rank 0 the most popular. zeta(n) is summed exactly up to 1M and
+// extended with the integral approximation beyond, so setup stays cheap on
+// multi-TB devices.
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta) : n_(std::max<uint64_t>(n, 2)), theta_(theta)
+    {
+        zetan_ = zeta(n_, theta_);
+        double zeta2 = zeta(2, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1.0 - std::pow(2.0 / double(n_), 1.0 - theta_)) / (1.0 - zeta2 / zetan_);
+    }
+
+    uint64_t operator()(FastRng& rng) const
+    {
+        double u = rng.unit();
+        double uz = u * zetan_;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+        uint64_t r = uint64_t(double(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(r, n_ - 1);
+    }
+
+private:
+    static double zeta(uint64_t n, double theta)
+    {
+        const uint64_t exact = std::min<uint64_t>(n, 1u << 20);
+        double s = 0.0;
+        for (uint64_t i = 1; i <= exact; ++i) s += 1.0 / std::pow(double(i), theta);
+        if (n > exact)
+            s += (std::pow(double(n), 1.0 - theta) - std::pow(double(exact), 1.0 - theta)) / (1.0 - theta);
+        return s;
+    }
+
+    uint64_t n_;
+    double theta_;
+    double zetan_, alpha_, eta_;
+};
+
+enum class Pattern { Random, Sequential, Stride, Zipf };
+
+inline bool parse_pattern(const std::string& s, Pattern& out)
+{
+    if (s == "rand" || s == "random") out = Pattern::Random;
+    else if (s == "seq" || s == "sequential") out = Pattern::Sequential;
+    else if (s == "stride") out = Pattern::Stride;
+    else if (s == "zipf") out = Pattern::Zipf;
+    else return false;
+    return true;
+}
+
+inline const char* pattern_name(Pattern p)
+{
+    switch (p) {
+        case Pattern::Random: return "rand";
+        case Pattern::Sequential: return "seq";
+        case Pattern::Stride: return "stride";
+        case Pattern::Zipf: return "zipf";
+    }
+    return "?";
+}
+
+// Block index stream over [0, blocks). Sequential and strided streams start
+// at `start` (so parallel jobs sharing a region begin at different places);
+// strided access steps by `stride` blocks and shifts one lane on wrap so every
+// block is eventually visited.
+class AccessPattern {
+public:
+    AccessPattern(Pattern p, uint64_t blocks, uint64_t stride, double zipf_theta, uint64_t start)
+        : p_(p), blocks_(std::max<uint64_t>(blocks, 1)), stride_(std::max<uint64_t>(stride, 1)),
+          pos_(start % blocks_), lane_(pos_ % stride_)
+    {
+        if (p_ == Pattern::Zipf) zipf_.emplace(blocks_, zipf_theta);
+    }
+
+    uint64_t next(FastRng& rng)
+    {
+        switch (p_) {
+            case Pattern::Random: return rng.below(blocks_);
+            case Pattern::Sequential: {
+                uint64_t b = pos_;
+                if (++pos_ == blocks_) pos_ = 0;
+                return b;
+            }
+            case Pattern::Stride: {
+                uint64_t b = pos_;
+                pos_ += stride_;
+                if (pos_ >= blocks_) {
+                    lane_ = (lane_ + 1) % std::min(stride_, blocks_);
+                    pos_ = lane_;
+                }
+                return b;
+            }
+            case Pattern::Zipf:
+                // scramble ranks so the hot set is spread over the region
+                // instead of packed into its first few blocks
+                return scramble((*zipf_)(rng)) % blocks_;
+        }
+        return 0;
+    }
+
+private:
+    static uint64_t scramble(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    Pattern p_;
+    uint64_t blocks_;
+    uint64_t stride_;
+    uint64_t pos_;
+    uint64_t lane_;
+    std::optional<ZipfGenerator> zipf_;
+};
+
+// Parse a size like "4096", "64K", "256M", "4G", "1T" (binary units) or a
+// percentage of `whole` like "50%". Returns false on malformed input.
+inline bool parse_region(const std::string& s, uint64_t whole, uint64_t& out)
+{
+    if (s.empty()) return false;
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (end == s.c_str() || v < 0) return false;
+    std::string suffix(end);
+    if (suffix == "%") { out = (uint64_t)(whole * (v / 100.0)); return true; }
+    uint64_t mult = 1;
+    if (suffix.empty() || suffix == "B") mult = 1;
+    else if (suffix == "K" || suffix == "k") mult = 1ULL << 10;
+    else if (suffix == "M" || suffix == "m") mult = 1ULL << 20;
+    else if (suffix == "G" || suffix == "g") mult = 1ULL << 30;
+    else if (suffix == "T" || suffix == "t") mult = 1ULL << 40;
+    else return false;
+    out = (uint64_t)(v * (double)mult);
+    return true;
+}
+
+// Size of a regular file or block device behind fd, 0 if unknown.
+inline uint64_t fd_size_bytes(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t bytes = 0;
+        if (ioctl(fd, BLKGETSIZE64, &bytes) == 0) return bytes;
+        return 0;
+    }
+    return (uint64_t)st.st_size;
+}
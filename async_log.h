@@ -0,0 +1,213 @@
+#pragma once
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "fixed_ring_buffer.h"
+#include "tsc_clock.h"
+
+// Asynchronous logging for polling loops.
+// - The hot path only copies a 64-byte binary record (TSC stamp, format
+//   string pointer, up to five integer/floating-point arguments) into the
+//   producer's own SPSC ring. It does no formatting, no allocation and no
+//   syscall.
+// - A background thread, optionally pinned to a housekeeping core, drains
+//   every producer ring, formats the records ("{}" placeholders) and writes
+//   them with buffered stdio, flushing whenever the rings run dry.
+// - When a ring is full the record is dropped and counted rather than
+//   stalling the producer; dropped() reports the total.
+// Format strings must outlive the logger (string literals); arguments are
+// copied by value, so strings other than literals cannot be logged.
+// Producers are created before start(), one per producing thread.
+template<size_t RingSize = 4096>
+class BasicAsyncLog {
+public:
+    static constexpr unsigned kMaxArgs = 5;
+
+private:
+    enum : uint8_t { Unsigned = 0, Signed = 1, Float = 2 };
+
+    struct alignas(64) Record {
+        uint64_t tsc;
+        const char* fmt;
+        uint8_t nargs;
+        uint16_t types; // 2 bits per argument
+        uint64_t args[kMaxArgs];
+    };
+    static_assert(sizeof(Record) == 64, "log record should fill one cache line");
+    static_assert(sizeof(Record::types) * 8 >= 2 * kMaxArgs, "types needs 2 bits per argument");
+
+public:
+    class Producer {
+    public:
+        template<typename... Args>
+        void log(const char* fmt, Args... args) noexcept
+        {
+            static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+            static_assert(((std::is_arithmetic_v<Args> || std::is_enum_v<Args>) && ...),
+                          "only integer and floating-point arguments can be logged");
+            Record r;
+            r.tsc = clk_->now();
+            r.fmt = fmt;
+            r.nargs = (uint8_t)sizeof...(Args);
+            r.types = 0;
+            unsigned i = 0;
+            (put(r, i++, args), ...);
+            if (!ring_.push(r)) dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class BasicAsyncLog;
+        explicit Producer(const TscClock& clk) : clk_(&clk) {}
+
+        template<typename T>
+        static void put(Record& r, unsigned i, T v) noexcept
+        {
+            if constexpr (std::is_floating_point_v<T>) {
+                double d = (double)v;
+                std::memcpy(&r.args[i], &d, sizeof(d));
+                r.types |= (uint16_t)(Float << (2 * i));
+            } else if constexpr (std::is_enum_v<T>) {
+                r.args[i] = (uint64_t)(std::underlying_type_t<T>)v;
+            } else if constexpr (std::is_signed_v<T>) {
+                r.args[i] = (uint64_t)(int64_t)v;
+                r.types |= (uint16_t)(Signed << (2 * i));
+            } else {
+                r.args[i] = (uint64_t)v;
+            }
+        }
+
+        const TscClock* clk_;
+        std::atomic<uint64_t> dropped_{0};
+        FixedRingBuffer<Record, RingSize> ring_;
+    };
+
+    // out: where formatted lines go (stdout, stderr or a file the caller owns).
+    // cpu: housekeeping core for the writer thread, -1 = not pinned.
+    explicit BasicAsyncLog(FILE* out, int cpu = -1) : out_(out), cpu_(cpu), clk_(TscClock::instance())
+    {
+        t0_ = clk_.now();
+    }
+
+    ~BasicAsyncLog() { stop(); }
+
+    BasicAsyncLog(const BasicAsyncLog&) = delete;
+    BasicAsyncLog& operator=(const BasicAsyncLog&) = delete;
+
+    Producer& producer()
+    {
+        producers_.emplace_back(new Producer(clk_));
+        return *producers_.back();
+    }
+
+    void start()
+    {
+        running_.store(true, std::memory_order_release);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Drains whatever is still queued, then joins the writer thread.
+    void stop()
+    {
+        if (!thread_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        thread_.join();
+    }
+
+    uint64_t written() const noexcept { return written_.load(std::memory_order_relaxed); }
+
+    uint64_t dropped() const noexcept
+    {
+        uint64_t n = 0;
+        for (const auto& p : producers_) n += p->dropped();
+        return n;
+    }
+
+private:
+    void run()
+    {
+        if (cpu_ >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu_, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                std::fprintf(stderr, "Warning: could not pin log thread to cpu %d\n", cpu_);
+        }
+        for (;;) {
+            // read the flag first so records pushed before stop() are drained
+            const bool running = running_.load(std::memory_order_acquire);
+            size_t n = 0;
+            for (auto& p : producers_) {
+                while (auto r = p->ring_.pop()) {
+                    write(*r);
+                    ++n;
+                }
+            }
+            if (n) {
+                written_.fetch_add(n, std::memory_order_relaxed);
+                continue;
+            }
+            std::fflush(out_);
+            if (!running) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    void write(const Record& r)
+    {
+        char line[512];
+        const uint64_t ns = r.tsc > t0_ ? clk_.to_ns(r.tsc - t0_) : 0;
+        int len = std::snprintf(line, sizeof(line), "[%llu.%09llu] ", (unsigned long long)(ns / 1000000000ull),
+                                (unsigned long long)(ns % 1000000000ull));
+        size_t pos = (size_t)len;
+        unsigned arg = 0;
+        for (const char* f = r.fmt; *f && pos < sizeof(line) - 2; ++f) {
+            if (f[0] == '{' && f[1] == '}' && arg < r.nargs) {
+                pos += format_arg(line + pos, sizeof(line) - 1 - pos, r, arg++);
+                ++f;
+            } else {
+                line[pos++] = *f;
+            }
+        }
+        if (pos > sizeof(line) - 2) pos = sizeof(line) - 2;
+        line[pos++] = '\n';
+        std::fwrite(line, 1, pos, out_);
+    }
+
+    static size_t format_arg(char* dst, size_t room, const Record& r, unsigned i)
+    {
+        int n;
+        switch ((r.types >> (2 * i)) & 3u) {
+            case Signed: n = std::snprintf(dst, room, "%lld", (long long)(int64_t)r.args[i]); break;
+            case Float: {
+                double d;
+                std::memcpy(&d, &r.args[i], sizeof(d));
+                n = std::snprintf(dst, room, "%g", d);
+                break;
+            }
+            default: n = std::snprintf(dst, room, "%llu", (unsigned long long)r.args[i]); break;
+        }
+        return n < 0 ? 0 : std::min((size_t)n, room ? room - 1 : 0);
+    }
+
+    FILE* out_;
+    int cpu_;
+    const TscClock& clk_;
+    uint64_t t0_ = 0;
+    std::vector<std::unique_ptr<Producer>> producers_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> written_{0};
+};
+
+using AsyncLog = BasicAsyncLog<>;
@@ -0,0 +1,234 @@
+#pragma once
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Machine-readable benchmark results shared by myapp, the queue demos and the
+// DPDK receivers.
+// - Programs keep printing their human text; with --format json|csv they also
+//   collect metrics here and emit one document at the end.
+// - Every document carries run metadata (host, CPU model, kernel, compiler,
+//   git SHA, clock source, options) so results can be compared over time
+//   with scripts/bench_compare.py.
+// - Each metric records whether lower or higher is better (or neither, for
+//   counts like samples), which the comparison tool uses to decide what
+//   counts as a regression.
+
+// Generated at build time from `git describe --always --dirty`
+// (cmake/bench_git_sha.cmake); "unknown" when built outside CMake.
+#if __has_include("bench_git_sha.h")
+#include "bench_git_sha.h"
+#endif
+#ifndef BENCH_GIT_SHA
+#define BENCH_GIT_SHA "unknown"
+#endif
+
+enum class ReportFormat { Text, Json, Csv };
+enum class Better { Lower, Higher, None };
+
+inline bool parse_report_format(const std::string& s, ReportFormat& out)
+{
+    if (s == "text") out = ReportFormat::Text;
+    else if (s == "json") out = ReportFormat::Json;
+    else if (s == "csv") out = ReportFormat::Csv;
+    else return false;
+    return true;
+}
+
+class BenchReport {
+public:
+    explicit BenchReport(std::string bench) : bench_(std::move(bench)) {}
+
+    void option(const std::string& key, const std::string& value) { set(options_, key, value); }
+    void option(const std::string& key, const char* value) { set(options_, key, value); }
+    template<typename T>
+    void option(const std::string& key, const T& value)
+    {
+        std::ostringstream os;
+        os << value;
+        set(options_, key, os.str());
+    }
+
+    void clock_source(const std::string& s) { clock_ = s; }
+
+    void metric(const std::string& group, const std::string& name, double value, const std::string& unit,
+                Better better)
+    {
+        metrics_.push_back(Metric{group, name, value, unit, better});
+    }
+
+    // Standard latency block from any histogram with count/mean/min/max/
+    // percentile (HdrHistogram). `scale` converts recorded units to `unit`,
+    // e.g. 1e-3 for ns recorded and us reported.
+    template<typename Hist>
+    void latency(const std::string& group, const Hist& h, double scale, const std::string& unit)
+    {
+        metric(group, "samples", (double)h.count(), "count", Better::None);
+        if (h.count() == 0) return;
+        metric(group, "mean", h.mean() * scale, unit, Better::Lower);
+        metric(group, "min", (double)h.min() * scale, unit, Better::Lower);
+        metric(group, "max", (double)h.max() * scale, unit, Better::Lower);
+        static const std::pair<const char*, double> pcts[] = {
+            {"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p99.9", 99.9}, {"p99.99", 99.99}, {"p99.999", 99.999}};
+        for (const auto& [name, p] : pcts) metric(group, name, (double)h.percentile(p) * scale, unit, Better::Lower);
+    }
+
+    // Text is a no-op: the programs print their own human-readable output.
+    void write(std::ostream& os, ReportFormat fmt) const
+    {
+        if (fmt == ReportFormat::Json) write_json(os);
+        else if (fmt == ReportFormat::Csv) write_csv(os);
+    }
+
+    static std::string cpu_model()
+    {
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.rfind("model name", 0) == 0) {
+                auto colon = line.find(':');
+                if (colon != std::string::npos) return trim(line.substr(colon + 1));
+            }
+        }
+        return "unknown";
+    }
+
+    static std::string kernel()
+    {
+        utsname u;
+        if (uname(&u) != 0) return "unknown";
+        return std::string(u.sysname) + " " + u.release + " " + u.machine;
+    }
+
+private:
+    struct Metric {
+        std::string group;
+        std::string name;
+        double value;
+        std::string unit;
+        Better better;
+    };
+
+    static const char* better_name(Better b)
+    {
+        return b == Better::Lower ? "lower" : b == Better::Higher ? "higher" : "none";
+    }
+
+    static void set(std::vector<std::pair<std::string, std::string>>& kv, const std::string& k, const std::string& v)
+    {
+        for (auto& e : kv) if (e.first == k) { e.second = v; return; }
+        kv.emplace_back(k, v);
+    }
+
+    static std::string trim(const std::string& s)
+    {
+        size_t b = s.find_first_not_of(" \t"), e = s.find_last_not_of(" \t\r\n");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    }
+
+    std::vector<std::pair<std::string, std::string>> meta() const
+    {
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        char ts[32];
+        std::time_t now = std::time(nullptr);
+        std::tm tm{};
+        gmtime_r(&now, &tm);
+        std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        return {
+            {"bench", bench_},
+            {"timestamp", ts},
+            {"host", host},
+            {"cpu_model", cpu_model()},
+            {"cpus", std::to_string(std::thread::hardware_concurrency())},
+            {"kernel", kernel()},
+            {"compiler", __VERSION__},
+            {"git_sha", BENCH_GIT_SHA},
+            {"clock_source", clock_},
+        };
+    }
+
+    static std::string json_str(const std::string& s)
+    {
+        std::string out = "\"";
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        return out + "\"";
+    }
+
+    static std::string csv_str(const std::string& s)
+    {
+        if (s.find_first_of(",\"\n") == std::string::npos) return s;
+        std::string out = "\"";
+        for (char c : s) out += c == '"' ? std::string("\"\"") : std::string(1, c);
+        return out + "\"";
+    }
+
+    // JSON has no inf/nan; emit null (CSV readers get the same token).
+    static std::string num(double v)
+    {
+        if (!std::isfinite(v)) return "null";
+        std::ostringstream os;
+        os.precision(12);
+        os << v;
+        return os.str();
+    }
+
+    void write_json(std::ostream& os) const
+    {
+        os << "{\n  \"meta\": {";
+        const auto m = meta();
+        for (size_t i = 0; i < m.size(); ++i)
+            os << (i ? "," : "") << "\n    " << json_str(m[i].first) << ": " << json_str(m[i].second);
+        os << "\n  },\n  \"options\": {";
+        for (size_t i = 0; i < options_.size(); ++i)
+            os << (i ? "," : "") << "\n    " << json_str(options_[i].first) << ": " << json_str(options_[i].second);
+        os << "\n  },\n  \"metrics\": [";
+        for (size_t i = 0; i < metrics_.size(); ++i) {
+            const Metric& x = metrics_[i];
+            os << (i ? "," : "") << "\n    {\"group\": " << json_str(x.group) << ", \"name\": " << json_str(x.name)
+               << ", \"value\": " << num(x.value) << ", \"unit\": " << json_str(x.unit)
+               << ", \"better\": \"" << better_name(x.better) << "\"}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    // Metadata and options as "# key=value" comment lines, then one row per metric.
+    void write_csv(std::ostream& os) const
+    {
+        for (const auto& [k, v] : meta()) os << "# " << k << "=" << v << "\n";
+        for (const auto& [k, v] : options_) os << "# option." << k << "=" << v << "\n";
+        os << "bench,group,metric,value,unit,better\n";
+        for (const Metric& x : metrics_)
+            os << csv_str(bench_) << "," << csv_str(x.group) << "," << csv_str(x.name) << "," << num(x.value) << ","
+               << csv_str(x.unit) << "," << better_name(x.better) << "\n";
+    }
+
+    std::string bench_;
+    std::string clock_ = "steady_clock";
+    std::vector<std::pair<std::string, std::string>> options_;
+    std::vector<Metric> metrics_;
+};
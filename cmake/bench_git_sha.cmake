@@ -0,0 +1,26 @@
+# Writes bench_git_sha.h with `git describe --always --dirty` for bench_report.h.
+# Run at build time by the bench_git_sha target:
+#   cmake -DSOURCE_DIR=<repo> -DOUTPUT=<header> -P bench_git_sha.cmake
+# The header is only rewritten when the revision changes, so an unchanged
+# checkout does not rebuild the benchmarks.
+set(BENCH_GIT_SHA "unknown")
+find_package(Git QUIET)
+if(GIT_FOUND)
+	execute_process(COMMAND ${GIT_EXECUTABLE} describe --always --dirty
+		WORKING_DIRECTORY ${SOURCE_DIR}
+		OUTPUT_VARIABLE BENCH_GIT_SHA_OUT
+		OUTPUT_STRIP_TRAILING_WHITESPACE
+		ERROR_QUIET)
+	if(BENCH_GIT_SHA_OUT)
+		set(BENCH_GIT_SHA "${BENCH_GIT_SHA_OUT}")
+	endif()
+endif()
+
+set(CONTENT "// Generated by cmake/bench_git_sha.cmake; do not edit.\n#define BENCH_GIT_SHA \"${BENCH_GIT_SHA}\"\n")
+set(OLD_CONTENT "")
+if(EXISTS ${OUTPUT})
+	file(READ ${OUTPUT} OLD_CONTENT)
+endif()
+if(NOT OLD_CONTENT STREQUAL CONTENT)
+	file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
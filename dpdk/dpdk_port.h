@@ -0,0 +1,201 @@
+#pragma once
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Port and lcore setup shared by the DPDK receivers and dpdk_replay.
+// - N RX queues. With N > 1 the port hashes the IPv4 addresses + UDP ports
+//   (RSS), so one flow (one group and sender) always lands on the same queue
+//   and per-flow ordering is kept.
+// - Each queue gets its own mempool on the socket of the lcore that polls it,
+//   so mbuf alloc/free never crosses cores or NUMA nodes.
+// - Queue q is polled by the q-th worker lcore (rte_eal_remote_launch). A
+//   single queue with no worker lcores runs on the main lcore as before.
+// Virtual PMDs without RSS work too: net_pcap gives one RX queue per rx_pcap=
+// devarg, e.g. --vdev 'net_pcap0,rx_pcap=a.pcap,rx_pcap=b.pcap'.
+
+struct RxPortConfig {
+    uint16_t port = 0;
+    uint16_t rx_queues = 1;
+    uint16_t nb_rx_desc = 1024;
+    unsigned mbufs_per_queue = 8192;
+    unsigned mbuf_cache = 250;
+    uint64_t rx_offloads = 0; // e.g. RTE_ETH_RX_OFFLOAD_TIMESTAMP
+};
+
+// The lcore that polls each queue, followed (per_queue > 1) by the lcores of
+// each queue's later pipeline stages: lcores[q + k * rx_queues]. Fails (with a
+// message) if there are not enough worker lcores in the EAL core list.
+inline bool assign_queue_lcores(uint16_t rx_queues, std::vector<unsigned>& lcores, unsigned per_queue = 1)
+{
+    const size_t need = (size_t)rx_queues * per_queue;
+    lcores.clear();
+    unsigned id;
+    RTE_LCORE_FOREACH_WORKER(id) {
+        if (lcores.size() == need) break;
+        lcores.push_back(id);
+    }
+    if (lcores.size() == need) return true;
+    if (need == 1) {
+        lcores.assign(1, rte_get_main_lcore());
+        return true;
+    }
+    std::cerr << "--rx-queues " << rx_queues << (per_queue > 1 ? " with --pipeline" : "") << " needs " << need
+              << " worker lcores, EAL has " << lcores.size() << " (pass e.g. -l 0-" << need << ")" << std::endl;
+    return false;
+}
+
+// Configure the port with c.rx_queues RX queues (RSS on IPv4/UDP when there
+// is more than one) and one mempool per queue, then start it.
+inline bool setup_rx_port(const RxPortConfig& c, const std::vector<unsigned>& queue_lcores,
+                          std::vector<rte_mempool*>& pools)
+{
+    struct rte_eth_dev_info dev_info;
+    std::memset(&dev_info, 0, sizeof(dev_info));
+    if (rte_eth_dev_info_get(c.port, &dev_info) != 0) {
+        std::cerr << "Failed to get device info for port " << c.port << std::endl;
+        return false;
+    }
+    if (c.rx_queues > dev_info.max_rx_queues) {
+        std::cerr << "Port " << c.port << " supports at most " << dev_info.max_rx_queues << " RX queues" << std::endl;
+        return false;
+    }
+
+    struct rte_eth_conf port_conf;
+    std::memset(&port_conf, 0, sizeof(port_conf));
+    port_conf.rxmode.offloads = c.rx_offloads;
+    if (c.rx_queues > 1) {
+        const uint64_t want = RTE_ETH_RSS_IPV4 | RTE_ETH_RSS_NONFRAG_IPV4_UDP;
+        const uint64_t hf = want & dev_info.flow_type_rss_offloads;
+        if (hf == 0) {
+            std::cerr << "Warning: port " << c.port << " has no IPv4/UDP RSS; each queue receives whatever the PMD "
+                      << "puts on it" << std::endl;
+        } else {
+            port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;
+            port_conf.rx_adv_conf.rss_conf.rss_key = nullptr; // driver default key
+            port_conf.rx_adv_conf.rss_conf.rss_hf = hf;
+            if (hf != want) std::cerr << "Warning: port " << c.port << " hashes only part of the IPv4/UDP tuple" << std::endl;
+        }
+    }
+
+    if (rte_eth_dev_configure(c.port, c.rx_queues, 0, &port_conf) != 0) {
+        std::cerr << "Failed to configure port " << c.port << std::endl;
+        return false;
+    }
+
+    struct rte_eth_rxconf rx_conf;
+    std::memset(&rx_conf, 0, sizeof(rx_conf));
+    rx_conf.offloads = c.rx_offloads;
+
+    pools.assign(c.rx_queues, nullptr);
+    for (uint16_t q = 0; q < c.rx_queues; ++q) {
+        const unsigned socket = rte_lcore_to_socket_id(queue_lcores[q]);
+        char name[32];
+        std::snprintf(name, sizeof(name), "MBUF_POOL_P%u_Q%u", (unsigned)c.port, (unsigned)q);
+        pools[q] = rte_pktmbuf_pool_create(name, c.mbufs_per_queue, c.mbuf_cache, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+                                           (int)socket);
+        if (pools[q] == nullptr) {
+            std::cerr << "Failed to create mbuf pool for queue " << q << " on socket " << socket << std::endl;
+            return false;
+        }
+        if (rte_eth_rx_queue_setup(c.port, q, c.nb_rx_desc, socket, &rx_conf, pools[q]) != 0) {
+            std::cerr << "Failed to setup RX queue " << q << std::endl;
+            return false;
+        }
+    }
+
+    if (rte_eth_dev_start(c.port) != 0) {
+        std::cerr << "Failed to start port " << c.port << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// TX-only port for the replay generator: one TX queue, no RX queues, one
+// mempool on the socket of the sending lcore. Works with virtual PMDs too,
+// e.g. --vdev 'net_pcap0,tx_pcap=out.pcap' or --vdev net_ring0.
+inline bool setup_tx_port(uint16_t port, uint16_t nb_tx_desc, unsigned mbufs, unsigned lcore, rte_mempool*& pool)
+{
+    struct rte_eth_conf port_conf;
+    std::memset(&port_conf, 0, sizeof(port_conf));
+    if (rte_eth_dev_configure(port, 0, 1, &port_conf) != 0) {
+        std::cerr << "Failed to configure port " << port << " for TX" << std::endl;
+        return false;
+    }
+    const unsigned socket = rte_lcore_to_socket_id(lcore);
+    char name[32];
+    std::snprintf(name, sizeof(name), "TX_POOL_P%u", (unsigned)port);
+    pool = rte_pktmbuf_pool_create(name, mbufs, 250, 0, RTE_MBUF_DEFAULT_BUF_SIZE, (int)socket);
+    if (pool == nullptr) {
+        std::cerr << "Failed to create TX mbuf pool on socket " << socket << std::endl;
+        return false;
+    }
+    if (rte_eth_tx_queue_setup(port, 0, nb_tx_desc, socket, nullptr) != 0) {
+        std::cerr << "Failed to setup TX queue on port " << port << std::endl;
+        return false;
+    }
+    if (rte_eth_dev_start(port) != 0) {
+        std::cerr << "Failed to start port " << port << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Multicast MAC of an IPv4 group: 01:00:5e + low 23 bits.
+inline struct rte_ether_addr multicast_mac(uint32_t ip_host)
+{
+    struct rte_ether_addr mc;
+    uint32_t lower23 = ip_host & 0x7FFFFFu; // lower 23 bits
+    mc.addr_bytes[0] = 0x01;
+    mc.addr_bytes[1] = 0x00;
+    mc.addr_bytes[2] = 0x5e;
+    mc.addr_bytes[3] = (uint8_t)((lower23 >> 16) & 0x7Fu);
+    mc.addr_bytes[4] = (uint8_t)((lower23 >> 8) & 0xFFu);
+    mc.addr_bytes[5] = (uint8_t)(lower23 & 0xFFu);
+    return mc;
+}
+
+// Program the multicast MACs of a set of IPv4 groups (one list per port, the
+// call replaces it) so the NIC accepts those groups without promiscuous mode.
+inline void program_multicast_macs(uint16_t port_id, const std::vector<uint32_t>& groups)
+{
+    std::vector<struct rte_ether_addr> macs;
+    for (const uint32_t ip : groups) {
+        if ((ip & 0xF0000000u) != 0xE0000000u) {
+            std::cerr << "Warning: target IP " << (ip >> 24) << "." << (ip >> 16 & 0xFFu) << "." << (ip >> 8 & 0xFFu)
+                      << "." << (ip & 0xFFu) << " is not an IPv4 multicast address (224.0.0.0/4)." << std::endl;
+            continue;
+        }
+        macs.push_back(multicast_mac(ip));
+    }
+    if (macs.empty()) return;
+
+    int rc = rte_eth_dev_set_mc_addr_list(port_id, macs.data(), (uint32_t)macs.size());
+    if (rc != 0) {
+        std::cerr << "Warning: failed to set multicast MAC on port " << port_id << " (rc=" << rc << ")." << std::endl;
+        return;
+    }
+    for (const struct rte_ether_addr& mc : macs) {
+        char macbuf[64];
+        snprintf(macbuf, sizeof(macbuf), "%02x:%02x:%02x:%02x:%02x:%02x",
+            mc.addr_bytes[0], mc.addr_bytes[1], mc.addr_bytes[2], mc.addr_bytes[3], mc.addr_bytes[4], mc.addr_bytes[5]);
+        std::cout << "Programmed multicast MAC " << macbuf << " on port " << port_id << std::endl;
+    }
+}
+
+// Port-level drop counters: packets the NIC dropped because no descriptor
+// was free (imissed) or no mbuf could be allocated (rx_nombuf).
+inline void print_port_drops(uint16_t port_id)
+{
+    struct rte_eth_stats st;
+    if (rte_eth_stats_get(port_id, &st) != 0) return;
+    std::cout << "Port " << port_id << ": ipackets=" << st.ipackets << " imissed=" << st.imissed
+              << " ierrors=" << st.ierrors << " rx_nombuf=" << st.rx_nombuf << std::endl;
+}
@@ -2,16 +2,44 @@
 #include <rte_ethdev.h>
 #include <rte_mbuf.h>
 #include <rte_ether.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mempool.h>
+#include <rte_pause.h>
+#include <rte_prefetch.h>
 
 #include <getopt.h>
 #include <arpa/inet.h>
+#include <unistd.h>
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "dpdk_port.h"
+#include "feed_handler.h"
+#include "mbuf_pipeline.h"
+
 static volatile bool keep_running = true;
 
+struct RxWorker {
+    RxWorker(const std::vector<uint16_t>& ports, uint16_t queue, const std::vector<FeedLine>& lines,
+             uint64_t gap_timeout_ns, AsyncLog::Producer& log, FeedConsumer& consumer)
+        : ports(ports), queue_id(queue), handler(queue, lines, gap_timeout_ns, log, consumer)
+    {
+    }
+
+    std::vector<uint16_t> ports; // queue_id is polled on each of them
+    uint16_t queue_id;
+    FeedHandler handler;
+    std::unique_ptr<MbufRing> ring; // --pipeline: RX lcore -> worker lcore
+    PipelineStats pipe;             // --pipeline: RX lcore side
+};
+
 static void
 signal_handler(int signum)
 {
@@ -19,21 +47,148 @@ signal_handler(int signum)
     keep_running = false;
 }
 
-static uint32_t parse_ipv4_addr(const char* s)
+// "0" or "0,1"
+static bool parse_port_list(const char* s, std::vector<uint16_t>& ports)
+{
+    ports.clear();
+    for (const char* p = s; *p;) {
+        char* end;
+        const long v = std::strtol(p, &end, 10);
+        if (end == p || v < 0 || v >= RTE_MAX_ETHPORTS) return false;
+        ports.push_back((uint16_t)v);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return !ports.empty();
+}
+
+// Handles one burst as a whole: frame data is prefetched PREFETCH_OFFSET
+// packets ahead (mbuf headers twice as far) while the header fields are
+// gathered, one UdpFilter per line compares the whole burst with SIMD, and
+// every mbuf is returned with one rte_pktmbuf_free_bulk per group.
+// Matching frames go to the queue's FeedHandler (decode, A/B arbitration,
+// consumer ring), stamped with the TSC read after the burst.
+static void handle_burst(FeedHandler& h, struct rte_mbuf** bufs, uint16_t nb_rx, uint64_t rx_tsc)
+{
+    const uint16_t PREFETCH_OFFSET = 4;
+    const uint8_t* data[UdpFilter::kMaxBurst];
+    uint16_t lens[UdpFilter::kMaxBurst];
+    uint8_t line_of[UdpFilter::kMaxBurst];
+    struct rte_mbuf* keep[UdpFilter::kMaxBurst];
+    struct rte_mbuf* drop[UdpFilter::kMaxBurst];
+    RxQueueStats& s = h.stats();
+    ++s.bursts;
+
+    for (uint16_t i = 0; i < nb_rx && i < PREFETCH_OFFSET; ++i)
+        rte_prefetch0(rte_pktmbuf_mtod(bufs[i], void*));
+    for (uint16_t i = 0; i < nb_rx; ++i) {
+        if (i + 2 * PREFETCH_OFFSET < nb_rx) rte_prefetch0(bufs[i + 2 * PREFETCH_OFFSET]);
+        if (i + PREFETCH_OFFSET < nb_rx) rte_prefetch0(rte_pktmbuf_mtod(bufs[i + PREFETCH_OFFSET], void*));
+        data[i] = rte_pktmbuf_mtod(bufs[i], const uint8_t*);
+        lens[i] = rte_pktmbuf_data_len(bufs[i]); // headers must sit in the first segment
+    }
+
+    const uint32_t mask = h.classify(data, lens, nb_rx, line_of);
+    unsigned nkeep = 0, ndrop = 0;
+    for (uint16_t i = 0; i < nb_rx; ++i) {
+        if (mask >> i & 1u) {
+            keep[nkeep++] = bufs[i];
+            h.on_frame(line_of[i], data[i], lens[i], rx_tsc);
+        } else {
+            drop[ndrop++] = bufs[i];
+        }
+    }
+    s.matched += nkeep;
+    s.total += nb_rx;
+    if (ndrop) rte_pktmbuf_free_bulk(drop, ndrop);
+    if (nkeep) rte_pktmbuf_free_bulk(keep, nkeep);
+}
+
+// Poll one RX queue (on every port) until SIGINT/SIGTERM and handle each
+// burst on the same lcore. Runs on a worker lcore via rte_eal_remote_launch,
+// or on the main lcore for a single queue.
+static int rx_loop(void* arg)
 {
-    struct in_addr a;
-    if (inet_aton(s, &a) == 0) return 0;
-    return ntohl(a.s_addr);
+    RxWorker& w = *static_cast<RxWorker*>(arg);
+    FeedHandler& h = w.handler;
+    const TscClock& clk = TscClock::instance();
+    struct rte_mbuf* bufs[UdpFilter::kMaxBurst];
+
+    while (keep_running) {
+        for (const uint16_t port : w.ports) {
+            const uint16_t nb_rx = rte_eth_rx_burst(port, w.queue_id, bufs, UdpFilter::kMaxBurst);
+            if (nb_rx == 0) continue;
+            handle_burst(h, bufs, nb_rx, clk.now());
+        }
+        h.poll(clk);
+    }
+    return 0;
+}
+
+static_assert(MbufBurst::kMax <= UdpFilter::kMaxBurst, "a handed-off burst must fit handle_burst");
+
+// --pipeline, RX stage: poll and pass whole bursts to the worker lcore.
+static int pipeline_rx_loop(void* arg)
+{
+    RxWorker& w = *static_cast<RxWorker*>(arg);
+    MbufRing& ring = *w.ring;
+    PipelineStats& p = w.pipe;
+    const TscClock& clk = TscClock::instance();
+    MbufBurst b;
+
+    while (keep_running) {
+        for (const uint16_t port : w.ports) {
+            const uint16_t nb_rx = rte_eth_rx_burst(port, w.queue_id, b.m, MbufBurst::kMax);
+            if (nb_rx == 0) continue;
+            b.rx_tsc = clk.now();
+            b.port = port;
+            b.n = nb_rx;
+            p.occupancy.record(ring.size());
+            if (ring.push(b)) {
+                ++p.bursts;
+            } else {
+                ++p.full_bursts;
+                p.full_packets += nb_rx;
+                rte_pktmbuf_free_bulk(b.m, nb_rx);
+            }
+        }
+    }
+    return 0;
+}
+
+// --pipeline, worker stage: the frames are read where the NIC wrote them
+// and freed in bulk once handled.
+static int pipeline_worker_loop(void* arg)
+{
+    RxWorker& w = *static_cast<RxWorker*>(arg);
+    FeedHandler& h = w.handler;
+    MbufRing& ring = *w.ring;
+    const TscClock& clk = TscClock::instance();
+
+    while (keep_running) {
+        std::optional<MbufBurst> b = ring.pop();
+        if (b) handle_burst(h, b->m, b->n, b->rx_tsc);
+        else rte_pause();
+        h.poll(clk);
+    }
+    return 0;
 }
 
 int main(int argc, char** argv)
 {
     // Default application options (these are parsed after EAL init)
-    uint16_t app_port = 0; // default to first port
+    std::vector<uint16_t> app_ports{0}; // default to first port
     std::string target_ip_str = "224.0.0.100";
     uint32_t target_ip = RTE_IPV4(224,0,0,100);
     uint16_t target_port = 40000;
     bool enable_promisc = true;
+    uint16_t rx_queues = 1;
+    int log_cpu = -1; // housekeeping core for the log writer thread
+    int consumer_cpu = -1; // queue q's consumer thread runs on consumer_cpu + q
+    std::vector<FeedLine> extra_lines; // --line: B, C, ... (A is --target-ip/--target-port)
+    uint64_t gap_timeout_us = 100;
+    bool pipeline = false; // RX lcore + worker lcore per queue
+    RxPortConfig pc;       // mbuf pool sizing (--mbufs, --mbuf-cache)
 
     // Initialize EAL first. Application-specific args should be passed after the "--" when running.
     int eal_ret = rte_eal_init(argc, argv);
@@ -46,23 +201,53 @@ int main(int argc, char** argv)
     argv += eal_ret;
 
     // Parse application args (after EAL args / --)
+    enum { OPT_LOG_CPU = 256, OPT_CONSUMER_CPU, OPT_LINE, OPT_GAP_TIMEOUT, OPT_PIPELINE, OPT_MBUFS, OPT_MBUF_CACHE };
     const struct option longopts[] = {
         {"port", required_argument, nullptr, 'p'},
         {"target-ip", required_argument, nullptr, 'i'},
         {"target-port", required_argument, nullptr, 't'},
         {"no-promisc", no_argument, nullptr, 'n'},
         {"all-multicast", no_argument, nullptr, 'a'},
+        {"rx-queues", required_argument, nullptr, 'q'},
+        {"log-cpu", required_argument, nullptr, OPT_LOG_CPU},
+        {"consumer-cpu", required_argument, nullptr, OPT_CONSUMER_CPU},
+        {"line", required_argument, nullptr, OPT_LINE},
+        {"gap-timeout-us", required_argument, nullptr, OPT_GAP_TIMEOUT},
+        {"pipeline", no_argument, nullptr, OPT_PIPELINE},
+        {"mbufs", required_argument, nullptr, OPT_MBUFS},
+        {"mbuf-cache", required_argument, nullptr, OPT_MBUF_CACHE},
         {0,0,0,0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "p:i:t:na", longopts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:i:t:naq:", longopts, nullptr)) != -1) {
         switch (opt) {
-            case 'p': app_port = (uint16_t)atoi(optarg); break;
+            case 'p':
+                if (!parse_port_list(optarg, app_ports)) {
+                    std::cerr << "Bad --port '" << optarg << "' (expected N or N,M,...)" << std::endl;
+                    return 1;
+                }
+                break;
             case 'i': target_ip_str = optarg; target_ip = parse_ipv4_addr(optarg); break;
             case 't': target_port = (uint16_t)atoi(optarg); break;
             case 'n': enable_promisc = false; break;
             case 'a': enable_promisc = true; break;
+            case 'q': rx_queues = (uint16_t)std::max(1, atoi(optarg)); break;
+            case OPT_LOG_CPU: log_cpu = atoi(optarg); break;
+            case OPT_CONSUMER_CPU: consumer_cpu = atoi(optarg); break;
+            case OPT_LINE: {
+                FeedLine l;
+                if (!parse_line(optarg, l)) {
+                    std::cerr << "Bad --line '" << optarg << "' (expected IP:PORT)" << std::endl;
+                    return 1;
+                }
+                extra_lines.push_back(l);
+                break;
+            }
+            case OPT_GAP_TIMEOUT: gap_timeout_us = std::strtoull(optarg, nullptr, 10); break;
+            case OPT_PIPELINE: pipeline = true; break;
+            case OPT_MBUFS: pc.mbufs_per_queue = (unsigned)std::max(1024, atoi(optarg)); break;
+            case OPT_MBUF_CACHE: pc.mbuf_cache = (unsigned)std::max(0, atoi(optarg)); break;
             default: break;
         }
     }
@@ -73,122 +258,145 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    if (app_port >= nb_ports) {
-        std::cerr << "Requested port " << app_port << " >= available ports (" << nb_ports << ")" << std::endl;
-        return 1;
+    for (const uint16_t p : app_ports) {
+        if (p >= nb_ports) {
+            std::cerr << "Requested port " << p << " >= available ports (" << nb_ports << ")" << std::endl;
+            return 1;
+        }
     }
 
-    uint16_t port_id = app_port;
-    uint16_t rx_rings = 1;
-    uint16_t tx_rings = 0;
-    const uint16_t nb_rx_desc = 1024;
-
-    // Configure device
-    struct rte_eth_conf port_conf;
-    std::memset(&port_conf, 0, sizeof(port_conf));
-
-    if (rte_eth_dev_configure(port_id, rx_rings, tx_rings, &port_conf) != 0) {
-        std::cerr << "Failed to configure port " << port_id << std::endl;
+    std::vector<FeedLine> lines{FeedLine{target_ip, target_port, target_ip_str + ":" + std::to_string(target_port)}};
+    lines.insert(lines.end(), extra_lines.begin(), extra_lines.end());
+    if (lines.size() > FeedArbiter::kMaxLines) {
+        std::cerr << "At most " << FeedArbiter::kMaxLines << " lines are supported" << std::endl;
         return 1;
     }
-
-    // Allocate and set up one RX queue
-    struct rte_mempool* mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL",
-                                8192, 250, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
-    if (mbuf_pool == nullptr) {
-        std::cerr << "Failed to create mbuf pool" << std::endl;
+    if (lines.size() > 1 && rx_queues > 1) {
+        // RSS hashes the group address, so the copies of one message would land on different cores
+        std::cerr << "--line needs --rx-queues 1: all lines are arbitrated on one core" << std::endl;
         return 1;
     }
 
-    if (rte_eth_rx_queue_setup(port_id, 0, nb_rx_desc, rte_eth_dev_socket_id(port_id), nullptr, mbuf_pool) != 0) {
-        std::cerr << "Failed to setup RX queue" << std::endl;
+    // rte_pktmbuf_pool_create limits: per-lcore cache at most
+    // RTE_MEMPOOL_CACHE_MAX_SIZE and no more than n / 1.5
+    if (pc.mbuf_cache > RTE_MEMPOOL_CACHE_MAX_SIZE || pc.mbuf_cache * 3 / 2 > pc.mbufs_per_queue) {
+        std::cerr << "--mbuf-cache " << pc.mbuf_cache << " must be <= " << RTE_MEMPOOL_CACHE_MAX_SIZE
+                  << " and <= --mbufs / 1.5" << std::endl;
         return 1;
     }
 
-    if (rte_eth_dev_start(port_id) != 0) {
-        std::cerr << "Failed to start port" << std::endl;
-        return 1;
-    }
+    // queue q is polled by queue_lcores[q]; its mempool lives on that lcore's
+    // socket. With --pipeline its worker stage runs on queue_lcores[rx_queues + q].
+    std::vector<unsigned> queue_lcores;
+    if (!assign_queue_lcores(rx_queues, queue_lcores, pipeline ? 2 : 1)) return 1;
 
-    if (enable_promisc) {
-        rte_eth_promiscuous_enable(port_id);
-    } else {
-        // optionally enable all-multicast if requested via other flags; here we can leave as default
-    }
+    std::vector<uint32_t> groups;
+    for (const FeedLine& l : lines) groups.push_back(l.ip);
+    MempoolWatch mempools;
+    for (const uint16_t port_id : app_ports) {
+        pc.port = port_id;
+        pc.rx_queues = rx_queues;
+        std::vector<struct rte_mempool*> pools;
+        if (!setup_rx_port(pc, queue_lcores, pools)) return 1;
+        for (struct rte_mempool* p : pools) mempools.add(p);
 
-    // Program multicast MAC derived from target_ip so the NIC accepts that multicast address only
-    rte_eth_promiscuous_disable(port_id);
-    uint32_t ip_host = target_ip; // parse_ipv4_addr returned host-order
-    if ((ip_host & 0xF0000000u) != 0xE0000000u) {
-        std::cerr << "Warning: target IP " << target_ip_str << " is not an IPv4 multicast address (224.0.0.0/4)." << std::endl;
-    } else {
-        struct rte_ether_addr mc;
-        uint32_t lower23 = ip_host & 0x7FFFFFu; // lower 23 bits
-        mc.addr_bytes[0] = 0x01;
-        mc.addr_bytes[1] = 0x00;
-        mc.addr_bytes[2] = 0x5e;
-        mc.addr_bytes[3] = (uint8_t)((lower23 >> 16) & 0x7Fu);
-        mc.addr_bytes[4] = (uint8_t)((lower23 >> 8) & 0xFFu);
-        mc.addr_bytes[5] = (uint8_t)(lower23 & 0xFFu);
-
-        int rc = rte_eth_dev_set_mc_addr_list(port_id, &mc, 1);
-        if (rc != 0) {
-            std::cerr << "Warning: failed to set multicast MAC on port " << port_id << " (rc=" << rc << ")." << std::endl;
+        if (enable_promisc) {
+            rte_eth_promiscuous_enable(port_id);
         } else {
-            char macbuf[64];
-            snprintf(macbuf, sizeof(macbuf), "%02x:%02x:%02x:%02x:%02x:%02x",
-                mc.addr_bytes[0], mc.addr_bytes[1], mc.addr_bytes[2], mc.addr_bytes[3], mc.addr_bytes[4], mc.addr_bytes[5]);
-            std::cout << "Programmed multicast MAC " << macbuf << " on port " << port_id << std::endl;
+            // optionally enable all-multicast if requested via other flags; here we can leave as default
         }
+
+        // Program the multicast MACs derived from the line groups so the NIC accepts those addresses only
+        rte_eth_promiscuous_disable(port_id);
+        program_multicast_macs(port_id, groups);
     }
 
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
-    std::cout << "DPDK receiver started on port " << port_id << ", listening for IPv4 UDP dst " << target_ip_str << ":" << target_port << std::endl;
+    std::cout << "DPDK receiver started on port";
+    for (const uint16_t p : app_ports) std::cout << " " << p;
+    std::cout << ", listening for IPv4 UDP dst";
+    for (size_t i = 0; i < lines.size(); ++i) std::cout << " " << (char)('A' + i) << "=" << lines[i].name;
+    std::cout << std::endl;
 
-    const uint16_t BURST_SIZE = 32;
-    struct rte_mbuf* bufs[BURST_SIZE];
-    uint64_t total = 0;
-    uint64_t matched = 0;
+    AsyncLog log(stdout, log_cpu);
+    std::vector<std::unique_ptr<FeedConsumer>> consumers;
+    std::vector<RxWorker> workers;
+    workers.reserve(rx_queues);
+    for (uint16_t q = 0; q < rx_queues; ++q) {
+        consumers.emplace_back(new FeedConsumer(consumer_cpu < 0 ? -1 : consumer_cpu + q));
+        workers.emplace_back(app_ports, q, lines, gap_timeout_us * 1000, log.producer(), *consumers[q]);
+        if (pipeline) workers.back().ring = std::make_unique<MbufRing>();
+    }
+    log.start();
+    for (auto& c : consumers) c->start();
 
-    while (keep_running) {
-        const uint16_t nb_rx = rte_eth_rx_burst(port_id, 0, bufs, BURST_SIZE);
-        if (nb_rx == 0) continue;
-
-        for (uint16_t i = 0; i < nb_rx; ++i) {
-            struct rte_mbuf* m = bufs[i];
-            // minimal parsing: ethernet + IPv4 + UDP
-            unsigned char* pkt = rte_pktmbuf_mtod(m, unsigned char*);
-            uint16_t pkt_len = rte_pktmbuf_pkt_len(m);
-
-            // check length for Ethernet(14) + IPv4(20) + UDP(8)
-            if (pkt_len >= 14 + 20 + 8) {
-                uint16_t eth_type = (pkt[12] << 8) | pkt[13];
-                if (eth_type == 0x0800) { // IPv4
-                    unsigned char* ip = pkt + 14;
-                    uint8_t ihl = (ip[0] & 0x0f) * 4;
-                    uint8_t proto = ip[9];
-                    uint32_t dst = (ip[16] << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19];
-                    if (proto == 17 && dst == rte_be_to_cpu_32(target_ip)) { // UDP
-                        unsigned char* udp = ip + ihl;
-                        uint16_t dst_port = rte_be_to_cpu_16(*(uint16_t*)(udp + 2)); // beware unaligned access on some CPUs
-                        if (dst_port == target_port) {
-                            ++matched;
-                            std::cout << "matched pkt len=" << pkt_len << " total=" << total << " matched=" << matched << std::endl;
-                        }
-                    }
-                }
+    const unsigned main_lcore = rte_get_main_lcore();
+    for (uint16_t q = 0; q < rx_queues; ++q) {
+        if (queue_lcores[q] == main_lcore) continue;
+        if (pipeline) {
+            std::cout << "Queue " << q << " -> RX lcore " << queue_lcores[q] << ", worker lcore "
+                      << queue_lcores[rx_queues + q] << std::endl;
+            if (rte_eal_remote_launch(pipeline_worker_loop, &workers[q], queue_lcores[rx_queues + q]) != 0 ||
+                rte_eal_remote_launch(pipeline_rx_loop, &workers[q], queue_lcores[q]) != 0) {
+                std::cerr << "Failed to launch the pipeline for queue " << q << std::endl;
+                keep_running = false;
             }
-
-            ++total;
-            rte_pktmbuf_free(m);
+            continue;
+        }
+        std::cout << "Queue " << q << " -> lcore " << queue_lcores[q] << std::endl;
+        if (rte_eal_remote_launch(rx_loop, &workers[q], queue_lcores[q]) != 0) {
+            std::cerr << "Failed to launch RX queue " << q << " on lcore " << queue_lcores[q] << std::endl;
+            keep_running = false;
+        }
+    }
+    if (queue_lcores[0] == main_lcore) {
+        rx_loop(&workers[0]);
+    } else {
+        // the main lcore is free: watch mempool headroom
+        while (keep_running) {
+            mempools.sample();
+            usleep(100000);
+        }
+    }
+    rte_eal_mp_wait_lcore();
+    // the worker may have stopped with bursts still queued
+    for (RxWorker& w : workers) {
+        while (w.ring) {
+            std::optional<MbufBurst> b = w.ring->pop();
+            if (!b) break;
+            rte_pktmbuf_free_bulk(b->m, b->n);
         }
     }
+    for (auto& c : consumers) c->stop();
+    log.stop();
 
-    rte_eth_dev_stop(port_id);
-    rte_eth_dev_close(port_id);
+    for (const uint16_t port_id : app_ports) {
+        print_port_drops(port_id);
+        rte_eth_dev_stop(port_id);
+        rte_eth_dev_close(port_id);
+    }
 
-    std::cout << "Exiting. total=" << total << " matched=" << matched << std::endl;
+    std::vector<const FeedHandler*> handlers;
+    for (const RxWorker& w : workers) handlers.push_back(&w.handler);
+    print_feed_summary(handlers, lines);
+    if (pipeline) {
+        PipelineStats all;
+        for (const RxWorker& w : workers) {
+            if (rx_queues > 1) {
+                std::cout << "  queue " << w.queue_id << " ring: bursts=" << w.pipe.bursts
+                          << " full=" << w.pipe.full_bursts << " depth p99=" << w.pipe.occupancy.percentile(99)
+                          << std::endl;
+            }
+            all.merge(w.pipe);
+        }
+        std::cout << "Pipeline ring (" << kMbufRingSlots - 1 << " bursts): bursts=" << all.bursts
+                  << " full=" << all.full_bursts << " (" << all.full_packets << " pkts freed on the RX lcore)"
+                  << " depth p50=" << all.occupancy.percentile(50) << " p99=" << all.occupancy.percentile(99)
+                  << " max=" << all.occupancy.max() << std::endl;
+    }
+    mempools.print();
+    if (log.dropped()) std::cout << "Log records dropped (ring full): " << log.dropped() << std::endl;
     return 0;
 }
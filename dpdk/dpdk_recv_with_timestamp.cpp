@@ -3,55 +3,56 @@
 #include <rte_mbuf.h>
 #include <rte_ether.h>
 #include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
 
 #include <getopt.h>
 #include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
 #include <iostream>
 #include <csignal>
 #include <cstring>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#include "async_log.h"
+#include "bench_report.h"
+#include "interval_histogram.h"
+#include "tsc_clock.h"
+#include "dpdk_port.h"
+#include "rx_timestamp.h"
+
 static volatile bool keep_running = true;
 
-// Latency statistics
-struct latency_stats {
-    uint64_t min_ns;
-    uint64_t max_ns;
-    uint64_t total_ns;
-    uint64_t count;
-    uint64_t histogram[100];  // 100ns buckets up to 10us
-    
-    latency_stats() : min_ns(UINT64_MAX), max_ns(0), total_ns(0), count(0) {
-        memset(histogram, 0, sizeof(histogram));
-    }
-    
-    void update(uint64_t latency_ns) {
-        if (latency_ns < min_ns) min_ns = latency_ns;
-        if (latency_ns > max_ns) max_ns = latency_ns;
-        total_ns += latency_ns;
-        count++;
-        
-        uint32_t bucket = latency_ns / 100;
-        if (bucket < 100) histogram[bucket]++;
-    }
-    
-    void print() {
-        if (count == 0) return;
-        std::cout << "\n=== Latency Statistics ===" << std::endl;
-        std::cout << "Packets: " << count << std::endl;
-        std::cout << "Min: " << min_ns << " ns" << std::endl;
-        std::cout << "Avg: " << (total_ns / count) << " ns" << std::endl;
-        std::cout << "Max: " << max_ns << " ns" << std::endl;
-        
-        std::cout << "\nHistogram (100ns buckets):" << std::endl;
-        for (int i = 0; i < 100; i++) {
-            if (histogram[i] > 0) {
-                std::cout << i*100 << "-" << (i+1)*100 << "ns: " << histogram[i] << std::endl;
-            }
-        }
-    }
+// One RX queue and everything its lcore owns; merged by the main lcore at
+// shutdown.
+struct RxWorker {
+    uint16_t port_id = 0;
+    uint16_t queue_id = 0;
+    uint32_t target_ip = 0;   // host order
+    uint16_t target_port = 0;
+    bool hw_timestamp = false;
+    bool show_latency_stats = false;
+    AsyncLog::Producer* log = nullptr;
+    uint64_t total = 0;
+    uint64_t matched = 0;
+    std::unique_ptr<IntervalHistogram> latency; // stamp -> match, ns; per interval
+    RxTscField ts_field;
+    std::unique_ptr<NicClockSync> nic_clock;    // hw only
+    HdrHistogram sw_window;                     // software stamp error bound per burst, ns
+    uint64_t unstamped = 0;                     // hw mode: packets the NIC did not stamp
+    uint64_t stamp_after_match = 0;             // stamp later than the match (clock fit off)
 };
 
+static void print_latency(const char* title, const HdrHistogram& h)
+{
+    std::cout << title << " n=" << h.count() << " min=" << h.min() << "ns p50=" << h.percentile(50)
+              << "ns p90=" << h.percentile(90) << "ns p99=" << h.percentile(99) << "ns p99.9=" << h.percentile(99.9)
+              << "ns p99.99=" << h.percentile(99.99) << "ns max=" << h.max() << "ns" << std::endl;
+}
+
 static void
 signal_handler(int signum)
 {
@@ -66,6 +67,108 @@ static uint32_t parse_ipv4_addr(const char* s)
     return ntohl(a.s_addr);
 }
 
+// Poll one RX queue until SIGINT/SIGTERM. Runs on a worker lcore via
+// rte_eal_remote_launch, or on the main lcore for a single queue.
+static int rx_loop(void* arg)
+{
+    RxWorker& w = *static_cast<RxWorker*>(arg);
+    const TscClock& clk = TscClock::instance();
+    const uint16_t BURST_SIZE = 32;
+    struct rte_mbuf* bufs[BURST_SIZE];
+    uint64_t& total = w.total;
+    uint64_t& matched = w.matched;
+    const uint32_t target_ip = w.target_ip;
+    const uint16_t target_port = w.target_port;
+    const bool enable_hw_timestamp = w.hw_timestamp;
+    const bool show_latency_stats = w.show_latency_stats;
+
+    IntervalHistogram& latency = *w.latency;
+    const RxTscField& ts_field = w.ts_field;
+    BurstStamper stamper;
+
+    while (keep_running) {
+        // Bounds of the burst's arrival window for software stamps
+        const uint64_t rx_start_tsc = clk.start();
+        stamper.begin(rx_start_tsc);
+        if (enable_hw_timestamp) w.nic_clock->maybe_sample(rx_start_tsc);
+
+        const uint16_t nb_rx = rte_eth_rx_burst(w.port_id, w.queue_id, bufs, BURST_SIZE);
+        if (nb_rx == 0) {
+            stamper.idle();
+            if (show_latency_stats) latency.tick(clk.now());
+            continue;
+        }
+
+        const uint64_t rx_end_tsc = clk.now();
+        const uint64_t window = stamper.end(nb_rx, BURST_SIZE, rx_end_tsc);
+        if (!enable_hw_timestamp) w.sw_window.record(clk.to_ns(window));
+
+        for (uint16_t i = 0; i < nb_rx; ++i) {
+            struct rte_mbuf* m = bufs[i];
+            
+            // Packet timestamp in the TSC domain: the NIC stamp through the
+            // clock fit, or this packet's place in the burst's arrival window
+            uint64_t pkt_timestamp_tsc;
+            uint64_t nic_stamp;
+            bool hw_stamped = false;
+            if (enable_hw_timestamp && ts_field.nic(m, nic_stamp)) {
+                pkt_timestamp_tsc = w.nic_clock->to_tsc(nic_stamp);
+                hw_stamped = true;
+            } else {
+                if (enable_hw_timestamp) ++w.unstamped;
+                pkt_timestamp_tsc = stamper.stamp(i);
+            }
+
+            // Store timestamp in mbuf for later use
+            ts_field.tsc(m) = pkt_timestamp_tsc;
+            
+            // Parse packet
+            unsigned char* pkt = rte_pktmbuf_mtod(m, unsigned char*);
+            uint16_t pkt_len = rte_pktmbuf_pkt_len(m);
+
+            if (pkt_len >= 14 + 20 + 8) {
+                uint16_t eth_type = (pkt[12] << 8) | pkt[13];
+                if (eth_type == 0x0800) { // IPv4
+                    unsigned char* ip = pkt + 14;
+                    uint8_t ihl = (ip[0] & 0x0f) * 4;
+                    uint8_t proto = ip[9];
+                    uint32_t dst = (ip[16] << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19];
+                    if (proto == 17 && dst == target_ip) { // UDP
+                        unsigned char* udp = ip + ihl;
+                        uint16_t dst_port = rte_be_to_cpu_16(*(uint16_t*)(udp + 2));
+                        if (dst_port == target_port) {
+                            ++matched;
+                            
+                            // Calculate processing latency (from arrival to now)
+                            uint64_t processing_done_tsc = clk.stop();
+                            uint64_t latency_cycles = 0;
+                            if (processing_done_tsc >= pkt_timestamp_tsc) latency_cycles = processing_done_tsc - pkt_timestamp_tsc;
+                            else ++w.stamp_after_match;
+                            uint64_t latency_ns = clk.to_ns(latency_cycles);
+                            
+                            if (show_latency_stats) latency.record(latency_ns);
+                            
+                            // Convert timestamp to nanoseconds for display
+                            uint64_t timestamp_ns = clk.to_ns(pkt_timestamp_tsc);
+                            
+                            w.log->log(hw_stamped ? "[q{} HW] matched pkt len={} timestamp={}ns latency={}ns matched={}"
+                                                  : "[q{} SW] matched pkt len={} timestamp={}ns latency={}ns matched={}",
+                                       w.queue_id, pkt_len, timestamp_ns, latency_ns, matched);
+                        }
+                    }
+                }
+            }
+
+            ++total;
+            rte_pktmbuf_free(m);
+        }
+        
+        // hand the interval's histogram to the stats thread; printing happens there
+        if (show_latency_stats) latency.tick(rx_end_tsc);
+    }
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     // Default application options
@@ -76,6 +179,11 @@ int main(int argc, char** argv)
     bool enable_promisc = true;
     bool enable_hw_timestamp = false;
     bool show_latency_stats = false;
+    uint16_t rx_queues = 1;
+    int log_cpu = -1; // housekeeping core for the log writer thread
+    unsigned interval_ms = 1000; // latency snapshot period with -L, 0 = summary only
+    unsigned clock_sync_ms = 100; // NIC clock vs TSC sampling period with -H
+    ReportFormat format = ReportFormat::Text;
 
     // Initialize EAL first
     int eal_ret = rte_eal_init(argc, argv);
@@ -88,6 +196,7 @@ int main(int argc, char** argv)
     argv += eal_ret;
 
     // Parse application args
+    enum { OPT_LOG_CPU = 256, OPT_INTERVAL_MS, OPT_CLOCK_SYNC_MS };
     const struct option longopts[] = {
         {"port", required_argument, nullptr, 'p'},
         {"target-ip", required_argument, nullptr, 'i'},
@@ -95,11 +204,16 @@ int main(int argc, char** argv)
         {"no-promisc", no_argument, nullptr, 'n'},
         {"hw-timestamp", no_argument, nullptr, 'H'},
         {"latency-stats", no_argument, nullptr, 'L'},
+        {"format", required_argument, nullptr, 'F'}, // text, json, csv
+        {"rx-queues", required_argument, nullptr, 'q'},
+        {"log-cpu", required_argument, nullptr, OPT_LOG_CPU},
+        {"interval-ms", required_argument, nullptr, OPT_INTERVAL_MS},
+        {"clock-sync-ms", required_argument, nullptr, OPT_CLOCK_SYNC_MS},
         {0,0,0,0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "p:i:t:nHL", longopts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:i:t:nHLF:q:", longopts, nullptr)) != -1) {
         switch (opt) {
             case 'p': app_port = (uint16_t)atoi(optarg); break;
             case 'i': target_ip_str = optarg; target_ip = parse_ipv4_addr(optarg); break;
@@ -107,9 +221,22 @@ int main(int argc, char** argv)
             case 'n': enable_promisc = false; break;
             case 'H': enable_hw_timestamp = true; break;
             case 'L': show_latency_stats = true; break;
+            case 'q': rx_queues = (uint16_t)std::max(1, atoi(optarg)); break;
+            case OPT_LOG_CPU: log_cpu = atoi(optarg); break;
+            case OPT_INTERVAL_MS: interval_ms = (unsigned)std::max(0, atoi(optarg)); break;
+            case OPT_CLOCK_SYNC_MS: clock_sync_ms = (unsigned)std::max(1, atoi(optarg)); break;
+            case 'F':
+                if (!parse_report_format(optarg, format)) {
+                    std::cerr << "Unknown format '" << optarg << "' (expected text, json or csv)" << std::endl;
+                    return 1;
+                }
+                break;
             default: break;
         }
     }
+    // structured output owns stdout; human text moves to stderr
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
 
     unsigned nb_ports = rte_eth_dev_count_avail();
     if (nb_ports == 0) {
@@ -123,27 +250,28 @@ int main(int argc, char** argv)
     }
 
     uint16_t port_id = app_port;
-    uint16_t rx_rings = 1;
-    uint16_t tx_rings = 0;
-    const uint16_t nb_rx_desc = 1024;
 
-    // Get TSC frequency for timestamp conversion
+    // Software timestamps and their ns conversion go through TscClock
+    // (calibrated here, before the RX loop); DPDK's own figure is kept for the
+    // stats interval and as a cross-check.
     uint64_t tsc_hz = rte_get_tsc_hz();
-    double ns_per_cycle = 1000000000.0 / (double)tsc_hz;
-    std::cout << "TSC frequency: " << tsc_hz << " Hz" << std::endl;
-    std::cout << "TSC resolution: " << ns_per_cycle << " ns/cycle" << std::endl;
+    const TscClock& clk = TscClock::instance();
+    std::cout << "TSC frequency: " << tsc_hz << " Hz (calibrated " << clk.hz() << " Hz, " << clk.source() << ")"
+              << std::endl;
+    std::cout << "TSC resolution: " << 1.0 / clk.ticks_per_ns() << " ns/cycle" << std::endl;
 
     // Configure device with optional hardware timestamping
-    struct rte_eth_conf port_conf;
-    std::memset(&port_conf, 0, sizeof(port_conf));
-    
+    RxPortConfig pc;
+    pc.port = port_id;
+    pc.rx_queues = rx_queues;
     if (enable_hw_timestamp) {
         // Check if device supports hardware timestamping
         struct rte_eth_dev_info dev_info;
+        std::memset(&dev_info, 0, sizeof(dev_info));
         rte_eth_dev_info_get(port_id, &dev_info);
         
         if (dev_info.rx_offload_capa & RTE_ETH_RX_OFFLOAD_TIMESTAMP) {
-            port_conf.rxmode.offloads |= RTE_ETH_RX_OFFLOAD_TIMESTAMP;
+            pc.rx_offloads |= RTE_ETH_RX_OFFLOAD_TIMESTAMP;
             std::cout << "Hardware timestamping enabled on port " << port_id << std::endl;
         } else {
             std::cerr << "Warning: Hardware timestamping not supported on port " << port_id << std::endl;
@@ -151,36 +279,11 @@ int main(int argc, char** argv)
         }
     }
 
-    if (rte_eth_dev_configure(port_id, rx_rings, tx_rings, &port_conf) != 0) {
-        std::cerr << "Failed to configure port " << port_id << std::endl;
-        return 1;
-    }
-
-    // Allocate and set up one RX queue
-    struct rte_mempool* mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL",
-                                8192, 250, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
-    if (mbuf_pool == nullptr) {
-        std::cerr << "Failed to create mbuf pool" << std::endl;
-        return 1;
-    }
-
-    // Setup RX queue with timestamp offload if enabled
-    struct rte_eth_rxconf rx_conf;
-    std::memset(&rx_conf, 0, sizeof(rx_conf));
-    if (enable_hw_timestamp) {
-        rx_conf.offloads |= RTE_ETH_RX_OFFLOAD_TIMESTAMP;
-    }
-
-    if (rte_eth_rx_queue_setup(port_id, 0, nb_rx_desc, rte_eth_dev_socket_id(port_id), 
-                                &rx_conf, mbuf_pool) != 0) {
-        std::cerr << "Failed to setup RX queue" << std::endl;
-        return 1;
-    }
-
-    if (rte_eth_dev_start(port_id) != 0) {
-        std::cerr << "Failed to start port" << std::endl;
-        return 1;
-    }
+    // queue q is polled by queue_lcores[q]; its mempool lives on that lcore's socket
+    std::vector<unsigned> queue_lcores;
+    if (!assign_queue_lcores(rx_queues, queue_lcores)) return 1;
+    std::vector<struct rte_mempool*> pools;
+    if (!setup_rx_port(pc, queue_lcores, pools)) return 1;
 
     if (enable_promisc) {
         rte_eth_promiscuous_enable(port_id);
@@ -188,24 +291,27 @@ int main(int argc, char** argv)
 
     // Program multicast MAC
     rte_eth_promiscuous_disable(port_id);
-    uint32_t ip_host = target_ip;
-    if ((ip_host & 0xF0000000u) != 0xE0000000u) {
-        std::cerr << "Warning: target IP " << target_ip_str << " is not an IPv4 multicast address" << std::endl;
-    } else {
-        struct rte_ether_addr mc;
-        uint32_t lower23 = ip_host & 0x7FFFFFu;
-        mc.addr_bytes[0] = 0x01;
-        mc.addr_bytes[1] = 0x00;
-        mc.addr_bytes[2] = 0x5e;
-        mc.addr_bytes[3] = (uint8_t)((lower23 >> 16) & 0x7Fu);
-        mc.addr_bytes[4] = (uint8_t)((lower23 >> 8) & 0xFFu);
-        mc.addr_bytes[5] = (uint8_t)(lower23 & 0xFFu);
-
-        int rc = rte_eth_dev_set_mc_addr_list(port_id, &mc, 1);
-        if (rc != 0) {
-            std::cerr << "Warning: failed to set multicast MAC (rc=" << rc << ")" << std::endl;
+    program_multicast_macs(port_id, {target_ip});
+
+    RxTscField ts_field;
+    if (!ts_field.init(enable_hw_timestamp)) return 1;
+    // NIC stamps are only usable through a clock fit; without rte_eth_read_clock
+    // there is nothing to convert them with
+    std::vector<std::unique_ptr<NicClockSync>> nic_clocks;
+    for (uint16_t q = 0; enable_hw_timestamp && q < rx_queues; ++q) {
+        nic_clocks.push_back(std::make_unique<NicClockSync>(port_id, (uint64_t)clock_sync_ms * 1000000));
+        if (!nic_clocks.back()->prime()) {
+            std::cerr << "Warning: rte_eth_read_clock is not supported on port " << port_id
+                      << "; falling back to software timestamps" << std::endl;
+            enable_hw_timestamp = false;
+            nic_clocks.clear();
         }
     }
+    if (enable_hw_timestamp) {
+        const NicClockSync& c = *nic_clocks[0];
+        std::cout << "NIC clock: " << c.slope() << " TSC ticks per NIC tick, read takes " << c.best_read_ns()
+                  << " ns, resampled every " << clock_sync_ms << " ms" << std::endl;
+    }
 
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
@@ -213,113 +319,139 @@ int main(int argc, char** argv)
     std::cout << "DPDK receiver started on port " << port_id 
               << ", listening for IPv4 UDP dst " << target_ip_str << ":" << target_port << std::endl;
     if (enable_hw_timestamp) {
-        std::cout << "Using hardware timestamps" << std::endl;
+        std::cout << "Using hardware timestamps (converted to TSC)" << std::endl;
     } else {
-        std::cout << "Using software TSC timestamps" << std::endl;
+        std::cout << "Using software TSC timestamps (per packet, within the burst arrival window)" << std::endl;
     }
 
-    const uint16_t BURST_SIZE = 32;
-    struct rte_mbuf* bufs[BURST_SIZE];
-    uint64_t total = 0;
-    uint64_t matched = 0;
-    
-    latency_stats lstats;
-    uint64_t last_stats_print = rte_rdtsc();
-    const uint64_t stats_interval_cycles = tsc_hz;  // Print stats every 1 second
-
-    while (keep_running) {
-        // Capture timestamp BEFORE rx_burst for latency measurement
-        uint64_t rx_start_tsc = rte_rdtsc();
-        
-        const uint16_t nb_rx = rte_eth_rx_burst(port_id, 0, bufs, BURST_SIZE);
-        if (nb_rx == 0) continue;
-        
-        uint64_t rx_end_tsc = rte_rdtsc();
-
-        for (uint16_t i = 0; i < nb_rx; ++i) {
-            struct rte_mbuf* m = bufs[i];
-            
-            // Get packet timestamp
-            uint64_t pkt_timestamp_tsc;
-            const char* timestamp_source;
-            
-            if (enable_hw_timestamp && (m->ol_flags & RTE_MBUF_F_RX_TIMESTAMP)) {
-                // Hardware timestamp available
-                pkt_timestamp_tsc = m->timestamp;
-                timestamp_source = "HW";
-            } else {
-                // Use software timestamp (approximation - actual arrival is between rx_start and rx_end)
-                pkt_timestamp_tsc = rx_start_tsc;
-                timestamp_source = "SW";
-            }
-            
-            // Store timestamp in mbuf for later use
-            m->udata64 = pkt_timestamp_tsc;
-            
-            // Parse packet
-            unsigned char* pkt = rte_pktmbuf_mtod(m, unsigned char*);
-            uint16_t pkt_len = rte_pktmbuf_pkt_len(m);
-
-            if (pkt_len >= 14 + 20 + 8) {
-                uint16_t eth_type = (pkt[12] << 8) | pkt[13];
-                if (eth_type == 0x0800) { // IPv4
-                    unsigned char* ip = pkt + 14;
-                    uint8_t ihl = (ip[0] & 0x0f) * 4;
-                    uint8_t proto = ip[9];
-                    uint32_t dst = (ip[16] << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19];
-                    if (proto == 17 && dst == rte_be_to_cpu_32(target_ip)) { // UDP
-                        unsigned char* udp = ip + ihl;
-                        uint16_t dst_port = rte_be_to_cpu_16(*(uint16_t*)(udp + 2));
-                        if (dst_port == target_port) {
-                            ++matched;
-                            
-                            // Calculate processing latency (from arrival to now)
-                            uint64_t processing_done_tsc = rte_rdtsc();
-                            uint64_t latency_cycles = processing_done_tsc - pkt_timestamp_tsc;
-                            uint64_t latency_ns = (uint64_t)(latency_cycles * ns_per_cycle);
-                            
-                            if (show_latency_stats) {
-                                lstats.update(latency_ns);
-                            }
-                            
-                            // Convert timestamp to nanoseconds for display
-                            uint64_t timestamp_ns = (uint64_t)(pkt_timestamp_tsc * ns_per_cycle);
-                            
-                            std::cout << "[" << timestamp_source << "] "
-                                      << "matched pkt len=" << pkt_len 
-                                      << " timestamp=" << timestamp_ns << "ns"
-                                      << " latency=" << latency_ns << "ns"
-                                      << " total=" << total 
-                                      << " matched=" << matched << std::endl;
-                        }
+    // per-packet lines go through the log thread; stderr when stdout carries the report
+    AsyncLog log(format == ReportFormat::Text ? stdout : stderr, log_cpu);
+    std::vector<RxWorker> workers(rx_queues);
+    for (uint16_t q = 0; q < rx_queues; ++q) {
+        RxWorker& w = workers[q];
+        w.port_id = port_id;
+        w.queue_id = q;
+        w.target_ip = target_ip;
+        w.target_port = target_port;
+        w.hw_timestamp = enable_hw_timestamp;
+        w.show_latency_stats = show_latency_stats;
+        w.log = &log.producer();
+        w.latency = std::make_unique<IntervalHistogram>(clk.from_ns((uint64_t)interval_ms * 1000000), clk.now());
+        w.ts_field = ts_field;
+        if (enable_hw_timestamp) w.nic_clock = std::move(nic_clocks[q]);
+    }
+    log.start();
+
+    // Interval snapshots are printed here, never on an RX lcore. Each one is
+    // merged into its queue's session total before it is handed back.
+    std::vector<HdrHistogram> latency_totals(rx_queues);
+    std::thread stats_thread;
+    if (show_latency_stats && interval_ms > 0) {
+        stats_thread = std::thread([&] {
+            const uint64_t t0 = clk.now();
+            while (keep_running) {
+                usleep(std::min(interval_ms * 1000u / 4, 100000u));
+                for (RxWorker& w : workers) {
+                    const IntervalHistogram::Snapshot s = w.latency->take();
+                    if (s.hist == nullptr) continue;
+                    if (s.hist->count() > 0) {
+                        char title[64];
+                        std::snprintf(title, sizeof(title), "[q%u +%.1fs]", (unsigned)w.queue_id,
+                                      (double)clk.to_ns(s.end_tsc - t0) / 1e9);
+                        print_latency(title, *s.hist);
                     }
+                    latency_totals[w.queue_id].merge(*s.hist);
+                    w.latency->release();
                 }
             }
+        });
+    }
 
-            ++total;
-            rte_pktmbuf_free(m);
-        }
-        
-        // Print periodic statistics
-        if (show_latency_stats) {
-            uint64_t now = rte_rdtsc();
-            if (now - last_stats_print > stats_interval_cycles) {
-                lstats.print();
-                last_stats_print = now;
-            }
+    const unsigned main_lcore = rte_get_main_lcore();
+    for (uint16_t q = 0; q < rx_queues; ++q) {
+        if (queue_lcores[q] == main_lcore) continue;
+        std::cout << "Queue " << q << " -> lcore " << queue_lcores[q] << std::endl;
+        if (rte_eal_remote_launch(rx_loop, &workers[q], queue_lcores[q]) != 0) {
+            std::cerr << "Failed to launch RX queue " << q << " on lcore " << queue_lcores[q] << std::endl;
+            keep_running = false;
         }
     }
+    if (queue_lcores[0] == main_lcore) {
+        rx_loop(&workers[0]);
+    } else {
+        while (keep_running) usleep(100000);
+    }
+    rte_eal_mp_wait_lcore();
+    if (stats_thread.joinable()) stats_thread.join();
+    log.stop();
 
+    print_port_drops(port_id);
     rte_eth_dev_stop(port_id);
     rte_eth_dev_close(port_id);
 
+    uint64_t total = 0;
+    uint64_t matched = 0;
+    HdrHistogram latency, sw_window;
+    uint64_t unstamped = 0, stamp_after_match = 0;
+    for (RxWorker& w : workers) {
+        if (rx_queues > 1) {
+            std::cout << "  queue " << w.queue_id << ": total=" << w.total << " matched=" << w.matched << std::endl;
+        }
+        total += w.total;
+        matched += w.matched;
+        w.latency->drain_into(latency_totals[w.queue_id]);
+        latency.merge(latency_totals[w.queue_id]);
+        sw_window.merge(w.sw_window);
+        unstamped += w.unstamped;
+        stamp_after_match += w.stamp_after_match;
+    }
+
     std::cout << "\n=== Final Statistics ===" << std::endl;
     std::cout << "Total packets: " << total << std::endl;
     std::cout << "Matched packets: " << matched << std::endl;
+    if (log.dropped()) std::cout << "Log records dropped (ring full): " << log.dropped() << std::endl;
     
-    if (show_latency_stats && matched > 0) {
-        lstats.print();
+    if (show_latency_stats && latency.count() > 0) {
+        std::cout << "\n=== Latency Statistics (" << (enable_hw_timestamp ? "hw" : "sw") << " stamp to match) ==="
+                  << std::endl;
+        print_latency("All queues:", latency);
+    }
+    if (sw_window.count() > 0) {
+        // every software stamp is off by less than its burst's window
+        print_latency("Software stamp window (error bound per burst):", sw_window);
+    }
+    if (enable_hw_timestamp) {
+        for (const RxWorker& w : workers) {
+            const NicClockSync& c = *w.nic_clock;
+            std::cout << "NIC clock fit [q" << w.queue_id << "]: samples=" << c.samples() << " rejected=" << c.rejected()
+                      << " tsc/nic=" << c.slope() << " drift=" << c.drift_ppm() << "ppm max residual="
+                      << c.max_residual_ns() << "ns" << std::endl;
+        }
+        std::cout << "Packets without a NIC stamp: " << unstamped << std::endl;
+    }
+    if (stamp_after_match) std::cout << "Stamps later than the match (counted as 0 ns): " << stamp_after_match << std::endl;
+
+    BenchReport report("dpdk_recv_with_timestamp");
+    report.clock_source(enable_hw_timestamp ? std::string("nic+") + clk.source() : std::string(clk.source()));
+    report.option("port", port_id);
+    report.option("target", target_ip_str + ":" + std::to_string(target_port));
+    report.option("hw_timestamp", enable_hw_timestamp ? "yes" : "no");
+    report.option("rx_queues", rx_queues);
+    report.option("tsc_hz", clk.hz());
+    report.metric("rx", "packets", (double)total, "count", Better::None);
+    report.metric("rx", "matched", (double)matched, "count", Better::None);
+    report.metric("log", "dropped", (double)log.dropped(), "count", Better::Lower);
+    if (show_latency_stats) report.latency("latency", latency, 1.0, "ns");
+    if (sw_window.count() > 0) report.latency("sw_stamp_window", sw_window, 1.0, "ns");
+    if (enable_hw_timestamp) {
+        const NicClockSync& c = *workers[0].nic_clock;
+        report.metric("nic_clock", "samples", (double)c.samples(), "count", Better::None);
+        report.metric("nic_clock", "drift", c.drift_ppm(), "ppm", Better::None);
+        report.metric("nic_clock", "max_residual", (double)c.max_residual_ns(), "ns", Better::Lower);
+        report.metric("nic_clock", "unstamped", (double)unstamped, "count", Better::Lower);
     }
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, format);
 
     return 0;
 }
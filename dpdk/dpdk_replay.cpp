@@ -0,0 +1,155 @@
+// Feed replay generator over a DPDK TX queue: the same packets, pacing and
+// send stamps as pcap_replay (replay.h), built into mbufs and sent with
+// rte_eth_tx_burst from the main lcore.
+//   dpdk_replay -l 2 --vdev 'net_pcap0,tx_pcap=out.pcap' -- -r feed.pcap -i 239.1.1.1 -t 40000
+//   dpdk_replay -l 2 -a 0000:3b:00.1 -- --synth 1000000 --pps 1000000 --line 239.1.1.2:40001
+// With a port cabled back to the one dpdk_recv listens on, the receiver
+// reports one-way latency from the stamps; both sides read the TSC, so they
+// must share a host.
+
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+
+#include <getopt.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_report.h"
+#include "dpdk_port.h"
+#include "feed_handler.h"
+#include "replay.h"
+
+static volatile bool keep_running = true;
+
+static void
+signal_handler(int signum)
+{
+    (void)signum;
+    keep_running = false;
+}
+
+int main(int argc, char** argv)
+{
+    int eal_ret = rte_eal_init(argc, argv);
+    if (eal_ret < 0) {
+        std::cerr << "Failed to init EAL" << std::endl;
+        return 1;
+    }
+    argc -= eal_ret;
+    argv += eal_ret;
+
+    uint16_t port_id = 0;
+    ReplayOptions o;
+    auto on_extra = [&](int opt, const char* arg) {
+        if (opt == 'p') port_id = (uint16_t)atoi(arg);
+        return true;
+    };
+    if (!parse_replay_args(argc, argv, "p:", {{"port", required_argument, nullptr, 'p'}}, on_extra,
+                           "Usage: dpdk_replay [EAL args] -- (-r FILE.pcap | --synth N) [-p PORT] [-i IP -t PORT]"
+                           " [--line IP:PORT]...",
+                           o))
+        return 1;
+    o.batch = std::min(o.batch, 256u);
+    if (port_id >= rte_eth_dev_count_avail()) {
+        std::cerr << "Requested port " << port_id << " >= available ports (" << rte_eth_dev_count_avail() << ")"
+                  << std::endl;
+        return 1;
+    }
+
+    ReplayFeed feed;
+    if (!load_replay_feed(o, feed)) return 1;
+    const size_t nframes = feed.size();
+
+    struct rte_mempool* pool = nullptr;
+    if (!setup_tx_port(port_id, 1024, 8192, rte_lcore_id(), pool)) return 1;
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (o.format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::cout << "Replaying " << nframes << " packets on port " << port_id;
+    if (feed.skipped) std::cout << " (" << feed.skipped << " non-UDP skipped)";
+    std::cout << " to";
+    for (size_t i = 0; i < o.lines.size(); ++i) std::cout << " " << (char)('A' + i) << "=" << o.lines[i].name;
+    std::cout << std::endl;
+
+    const TscClock& clk = TscClock::instance();
+    ReplayPacer pacer(o.timing, o.pps, o.speed, feed.frames[0]);
+    const unsigned max_pkts = o.batch * (unsigned)o.lines.size();
+    std::vector<struct rte_mbuf*> mbufs(max_pkts);
+    std::vector<int> stamp_offs(max_pkts);
+    unsigned n = 0;
+    uint64_t sent = 0, nombuf = 0, tx_full_retries = 0, bursts = 0;
+
+    auto add = [&](unsigned, ReplayFrame& f) {
+        struct rte_mbuf* m = rte_pktmbuf_alloc(pool);
+        if (m == nullptr) {
+            ++nombuf;
+            return;
+        }
+        char* dst = rte_pktmbuf_append(m, (uint16_t)f.frame.size());
+        if (dst == nullptr) { // larger than one segment
+            rte_pktmbuf_free(m);
+            ++nombuf;
+            return;
+        }
+        std::memcpy(dst, f.frame.data(), f.frame.size());
+        stamp_offs[n] = f.stamp_off;
+        mbufs[n++] = m;
+    };
+    auto send = [&](uint64_t now) {
+        for (unsigned j = 0; j < n; ++j) {
+            if (stamp_offs[j] >= 0) put_tx_stamp(rte_pktmbuf_mtod_offset(mbufs[j], uint8_t*, stamp_offs[j]), now);
+        }
+
+        unsigned off = 0;
+        while (off < n) {
+            const uint16_t k = rte_eth_tx_burst(port_id, 0, &mbufs[off], (uint16_t)(n - off));
+            ++bursts;
+            off += k;
+            if (off < n) {
+                if (!keep_running) break;
+                ++tx_full_retries; // descriptor ring full: the NIC is the bottleneck
+            }
+        }
+        sent += off;
+        if (off < n) rte_pktmbuf_free_bulk(&mbufs[off], n - off);
+        n = 0;
+    };
+    const ReplayProgress progress = replay_frames(o, feed, pacer, [] { return keep_running; }, add, send);
+    const uint64_t elapsed_ns = clk.to_ns(clk.now() - pacer.start());
+
+    rte_eth_dev_stop(port_id);
+    rte_eth_dev_close(port_id);
+
+    const double secs = (double)elapsed_ns / 1e9;
+    const double rate = secs > 0 ? (double)sent / secs : 0.0;
+    std::cout << "Sent " << sent << " packets in " << secs << " s (" << (uint64_t)rate << " pps, "
+              << (bursts ? (double)sent / (double)bursts : 0.0) << " per tx_burst)";
+    if (progress.dropped) std::cout << ", dropped by --loss: " << progress.dropped;
+    if (nombuf) std::cout << ", mbuf alloc failures: " << nombuf;
+    if (tx_full_retries) std::cout << ", TX ring full retries: " << tx_full_retries;
+    std::cout << std::endl;
+    if (o.timing != ReplayTiming::Max) {
+        std::cout << "Pacing: late (>10us behind schedule)=" << pacer.late_frames()
+                  << " max lag=" << pacer.max_lag_ns() << "ns" << std::endl;
+    }
+
+    BenchReport report("dpdk_replay");
+    report.option("port", port_id);
+    report_replay(report, o, progress.loops, sent, rate, pacer);
+    report.metric("tx", "nombuf", (double)nombuf, "count", Better::Lower);
+    report.metric("tx", "ring_full_retries", (double)tx_full_retries, "count", Better::Lower);
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, o.format);
+    return 0;
+}
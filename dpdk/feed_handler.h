@@ -0,0 +1,204 @@
+#pragma once
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_log.h"
+#include "md_feed.h"
+#include "udp_filter.h"
+
+// Receive-side pipeline shared by dpdk_recv and sock_recv: line
+// classification, payload decode, A/B arbitration, handoff to the consumer
+// ring, the command-line helpers and the exit summary. No DPDK types; the
+// receivers only differ in how frames or payloads reach FeedHandler.
+
+// One subscription: a multicast group:port carrying the feed. With more
+// than one line, the lines are redundant copies (A/B) and are arbitrated.
+struct FeedLine {
+    uint32_t ip;   // host order
+    uint16_t port;
+    std::string name;
+};
+
+inline uint32_t parse_ipv4_addr(const char* s)
+{
+    struct in_addr a;
+    if (inet_aton(s, &a) == 0) return 0;
+    return ntohl(a.s_addr);
+}
+
+// "224.0.1.2:40001"
+inline bool parse_line(const char* s, FeedLine& l)
+{
+    const char* colon = std::strrchr(s, ':');
+    if (colon == nullptr) return false;
+    const std::string ip(s, colon);
+    l.ip = parse_ipv4_addr(ip.c_str());
+    l.port = (uint16_t)atoi(colon + 1);
+    l.name = s;
+    return l.ip != 0 && l.port != 0;
+}
+
+// Per-queue counters, written only by the thread polling that queue and
+// merged after it has stopped.
+struct alignas(64) RxQueueStats {
+    uint64_t total = 0;     // frames or datagrams received
+    uint64_t matched = 0;   // of those, addressed to one of the lines
+    uint64_t bursts = 0;    // non-empty polls
+    uint64_t ring_full = 0; // decoded messages dropped because the consumer ring was full
+};
+
+// Everything one receive thread does with its matching traffic. Gaps are
+// reported through the async log ring, never with stdio on the polling core.
+class FeedHandler {
+public:
+    FeedHandler(unsigned queue, const std::vector<FeedLine>& lines, uint64_t gap_timeout_ns,
+                AsyncLog::Producer& log, FeedConsumer& consumer)
+        : queue_(queue), log_(&log), consumer_(&consumer), arbiter_((unsigned)lines.size(), gap_timeout_ns)
+    {
+        for (const FeedLine& l : lines) filters_.emplace_back(l.ip, l.port);
+    }
+
+    // Classifies a burst of Ethernet frames (n <= UdpFilter::kMaxBurst)
+    // against every line. Returns the match mask; line_of[i] is set for
+    // each matching frame.
+    uint32_t classify(const uint8_t* const* frames, const uint16_t* lens, unsigned n, uint8_t* line_of) const
+    {
+        uint32_t mask = 0;
+        for (unsigned l = filters_.size(); l-- > 0;) {
+            uint32_t m = filters_[l].classify(frames, lens, n);
+            mask |= m;
+            for (; m; m &= m - 1) line_of[__builtin_ctz(m)] = (uint8_t)l; // lowest line wins
+        }
+        return mask;
+    }
+
+    // A frame that classify() matched to line.
+    void on_frame(unsigned line, const uint8_t* frame, uint16_t len, uint64_t rx_tsc)
+    {
+        const uint8_t* payload;
+        unsigned plen;
+        if (!udp_payload(frame, len, payload, plen)) {
+            arbiter_.malformed();
+            return;
+        }
+        on_payload(line, payload, plen, rx_tsc);
+    }
+
+    // A UDP payload received on line.
+    void on_payload(unsigned line, const uint8_t* p, unsigned len, uint64_t rx_tsc)
+    {
+        if (const uint64_t tx_tsc = take_tx_stamp(p, len))
+            one_way_.record(rx_tsc > tx_tsc ? clk_.to_ns(rx_tsc - tx_tsc) : 0);
+        if (len == 0 || len % kMdMessageSize != 0) {
+            arbiter_.malformed();
+            return;
+        }
+        auto deliver = [this](const MdMessage& m, uint64_t tsc) { this->deliver(m, tsc); };
+        auto gap = [this](uint64_t first, uint64_t count) { this->gap(first, count); };
+        for (unsigned off = 0; off < len; off += kMdMessageSize)
+            arbiter_.on_message(line, decode_md_message(p + off), rx_tsc, deliver, gap);
+    }
+
+    // Call once per poll round: gives up gaps that have timed out.
+    void poll(const TscClock& clk)
+    {
+        if (!arbiter_.gap_open()) return;
+        arbiter_.expire(
+            clk.now(), [this](const MdMessage& m, uint64_t tsc) { deliver(m, tsc); },
+            [this](uint64_t first, uint64_t count) { gap(first, count); });
+    }
+
+    unsigned queue() const { return queue_; }
+    RxQueueStats& stats() { return stats_; }
+    const RxQueueStats& stats() const { return stats_; }
+    const FeedArbiter& arbiter() const { return arbiter_; }
+    const FeedConsumer& consumer() const { return *consumer_; }
+    // sender TSC (replay generator on this host) -> rx stamp, ns
+    const HdrHistogram& one_way() const { return one_way_; }
+
+private:
+    void deliver(const MdMessage& m, uint64_t tsc)
+    {
+        if (!consumer_->ring().push(MdEvent{m.seq, m.symbol, m.qty, m.price, tsc})) ++stats_.ring_full;
+    }
+
+    void gap(uint64_t first, uint64_t count)
+    {
+        log_->log("[q{}] gap: seq {}..{} ({} missing)", queue_, first, first + count - 1, count);
+    }
+
+    unsigned queue_;
+    const TscClock& clk_ = TscClock::instance();
+    AsyncLog::Producer* log_;
+    FeedConsumer* consumer_;
+    std::vector<UdpFilter> filters_;
+    RxQueueStats stats_;
+    FeedArbiter arbiter_;
+    HdrHistogram one_way_;
+};
+
+// Exit summary: per-queue lines (with more than one queue), totals, feed
+// counters, per-line arbitration stats (with more than one line), the
+// sender-to-rx latency of stamped traffic and the wire-to-consumer latency.
+// Consumers must have been stopped.
+inline void print_feed_summary(const std::vector<const FeedHandler*>& handlers, const std::vector<FeedLine>& lines)
+{
+    RxQueueStats all;
+    SeqStats feed;
+    HdrHistogram latency, one_way;
+    uint64_t consumed = 0;
+    for (const FeedHandler* h : handlers) {
+        const RxQueueStats& s = h->stats();
+        const SeqStats& f = h->arbiter().stats();
+        const FeedConsumer& c = h->consumer();
+        if (handlers.size() > 1) {
+            std::cout << "  queue " << h->queue() << ": total=" << s.total << " matched=" << s.matched
+                      << " bursts=" << s.bursts << " messages=" << f.messages << " gaps=" << f.gaps
+                      << " ring_full=" << s.ring_full << " consumed=" << c.consumed() << std::endl;
+        }
+        all.total += s.total;
+        all.matched += s.matched;
+        all.bursts += s.bursts;
+        all.ring_full += s.ring_full;
+        feed.merge(f);
+        latency.merge(c.latency());
+        one_way.merge(h->one_way());
+        consumed += c.consumed();
+    }
+    std::cout << "Exiting. total=" << all.total << " matched=" << all.matched << std::endl;
+    std::cout << "Feed: messages=" << feed.messages << " gaps=" << feed.gaps << " missing=" << feed.missing
+              << " stale=" << feed.stale << " malformed=" << feed.malformed << " ring_full=" << all.ring_full
+              << " consumed=" << consumed << std::endl;
+    for (size_t i = 0; lines.size() > 1 && i < lines.size(); ++i) {
+        uint64_t received = 0, first = 0, duplicates = 0;
+        HdrHistogram lead;
+        for (const FeedHandler* h : handlers) {
+            const FeedArbiter::LineStats& l = h->arbiter().line((unsigned)i);
+            received += l.received;
+            first += l.first;
+            duplicates += l.duplicates;
+            lead.merge(l.lead);
+        }
+        std::cout << "Line " << (char)('A' + i) << " " << lines[i].name << ": received=" << received
+                  << " first=" << first << " duplicates=" << duplicates;
+        if (lead.count() > 0)
+            std::cout << " lead p50=" << lead.percentile(50) << "ns p99=" << lead.percentile(99) << "ns";
+        std::cout << std::endl;
+    }
+    if (one_way.count() > 0) {
+        std::cout << "One-way latency (sender TSC stamp, " << one_way.count() << " pkts): p50=" << one_way.percentile(50)
+                  << "ns p99=" << one_way.percentile(99) << "ns p99.9=" << one_way.percentile(99.9)
+                  << "ns max=" << one_way.max() << "ns" << std::endl;
+    }
+    if (latency.count() > 0) {
+        std::cout << "Wire-to-consumer latency (" << TscClock::instance().source() << ", " << latency.count()
+                  << " msgs): p50=" << latency.percentile(50) << "ns p99=" << latency.percentile(99)
+                  << "ns p99.9=" << latency.percentile(99.9) << "ns max=" << latency.max() << "ns" << std::endl;
+    }
+}
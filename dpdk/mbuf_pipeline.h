@@ -0,0 +1,90 @@
+#pragma once
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "fixed_ring_buffer.h"
+#include "hdr_histogram.h"
+
+// Zero-copy handoff from an RX lcore to a worker lcore (dpdk_recv
+// --pipeline).
+// - The RX lcore only polls: each burst goes into the queue's SPSC ring
+//   as mbuf pointers plus the burst's TSC. That is one push per burst, and
+//   the packet data is neither read nor copied.
+// - The worker lcore takes whole bursts, works on the frames in place, and
+//   returns them with one rte_pktmbuf_free_bulk per burst. The mbufs go back
+//   through the worker's mempool cache, so the cache size (--mbuf-cache)
+//   decides how often both sides touch the pool's shared ring.
+// - If the ring is full, the RX lcore frees the burst itself and counts it;
+//   it never waits for the worker.
+
+struct MbufBurst {
+    static constexpr unsigned kMax = 32; // == UdpFilter::kMaxBurst
+    uint64_t rx_tsc;
+    uint16_t port;
+    uint16_t n;
+    struct rte_mbuf* m[kMax];
+};
+
+// 127 usable bursts (about 4k mbufs) in flight per queue, well under the
+// 8192-mbuf pool, so a stalled worker shows up as ring_full before the NIC
+// runs out of buffers.
+constexpr size_t kMbufRingSlots = 128;
+using MbufRing = FixedRingBuffer<MbufBurst, kMbufRingSlots>;
+
+// RX-lcore side counters; merged after the lcores have stopped.
+struct alignas(64) PipelineStats {
+    uint64_t bursts = 0;        // pushed to the worker
+    uint64_t full_bursts = 0;   // ring full: freed on the RX lcore
+    uint64_t full_packets = 0;
+    HdrHistogram occupancy;     // ring depth in bursts, sampled at each push
+
+    void merge(const PipelineStats& o)
+    {
+        bursts += o.bursts;
+        full_bursts += o.full_bursts;
+        full_packets += o.full_packets;
+        occupancy.merge(o.occupancy);
+    }
+};
+
+// Mempool headroom, sampled from a housekeeping core (the main lcore while
+// it waits): rte_mempool_avail_count walks the per-lcore caches, so it does
+// not belong in a polling loop.
+class MempoolWatch {
+public:
+    void add(struct rte_mempool* p) { pools_.push_back(Pool{p, UINT32_MAX, 0}); }
+
+    void sample()
+    {
+        for (Pool& p : pools_) {
+            const unsigned avail = rte_mempool_avail_count(p.pool);
+            p.min_avail = std::min(p.min_avail, avail);
+            if (avail < MbufBurst::kMax) ++p.exhausted; // not even one burst left to refill the RX ring
+        }
+        ++samples_;
+    }
+
+    void print() const
+    {
+        if (samples_ == 0) return;
+        for (const Pool& p : pools_) {
+            std::cout << "Mempool " << p.pool->name << ": size=" << p.pool->size << " min free=" << p.min_avail
+                      << " exhausted samples=" << p.exhausted << "/" << samples_ << std::endl;
+        }
+    }
+
+private:
+    struct Pool {
+        struct rte_mempool* pool;
+        unsigned min_avail;
+        uint64_t exhausted;
+    };
+    std::vector<Pool> pools_;
+    uint64_t samples_ = 0;
+};
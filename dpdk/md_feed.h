@@ -0,0 +1,398 @@
+#pragma once
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "fixed_ring_buffer.h"
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+
+// Market-data feed handler pieces shared by the receivers. No DPDK types.
+//
+// Wire format: the UDP payload is one or more 24-byte messages, all fields
+// little-endian:
+//   0  u64 sequence number (per feed, +1 per message)
+//   8  u32 symbol id
+//  12  u32 quantity
+//  16  i64 price (fixed point, 1e-8 units)
+// A payload whose length is not a multiple of 24 (after removing an optional
+// send-stamp trailer, see below) is counted as malformed and skipped.
+
+struct MdMessage {
+    uint64_t seq;
+    uint32_t symbol;
+    uint32_t qty;
+    int64_t price;
+};
+
+// One decoded message as handed to the consumer thread. rx_tsc is the TSC
+// read right after the rx burst that carried it (the wire-arrival stand-in).
+struct MdEvent {
+    uint64_t seq;
+    uint32_t symbol;
+    uint32_t qty;
+    int64_t price;
+    uint64_t rx_tsc;
+};
+
+constexpr unsigned kMdMessageSize = 24;
+
+inline MdMessage decode_md_message(const uint8_t* p)
+{
+    MdMessage m;
+    std::memcpy(&m.seq, p, 8);
+    std::memcpy(&m.symbol, p + 8, 4);
+    std::memcpy(&m.qty, p + 12, 4);
+    std::memcpy(&m.price, p + 16, 8);
+    if constexpr (std::endian::native == std::endian::big) {
+        m.seq = __builtin_bswap64(m.seq);
+        m.symbol = __builtin_bswap32(m.symbol);
+        m.qty = __builtin_bswap32(m.qty);
+        m.price = (int64_t)__builtin_bswap64((uint64_t)m.price);
+    }
+    return m;
+}
+
+inline void encode_md_message(uint8_t* p, const MdMessage& m)
+{
+    MdMessage w = m;
+    if constexpr (std::endian::native == std::endian::big) {
+        w.seq = __builtin_bswap64(w.seq);
+        w.symbol = __builtin_bswap32(w.symbol);
+        w.qty = __builtin_bswap32(w.qty);
+        w.price = (int64_t)__builtin_bswap64((uint64_t)w.price);
+    }
+    std::memcpy(p, &w.seq, 8);
+    std::memcpy(p + 8, &w.symbol, 4);
+    std::memcpy(p + 12, &w.qty, 4);
+    std::memcpy(p + 16, &w.price, 8);
+}
+
+// Send timestamp trailer added by the replay generators: 16 bytes at the end
+// of the UDP payload, u64 magic then the sender's TSC (little-endian). A
+// payload of whole messages plus 16 bytes ending in the magic carries one;
+// the receiver strips it and, on the same host, gets one-way latency.
+constexpr unsigned kTxStampSize = 16;
+constexpr uint64_t kTxStampMagic = 0x504d415453785400ull; // "\0TxSTAMP" read as little-endian
+
+inline void put_tx_stamp(uint8_t* trailer, uint64_t tsc)
+{
+    uint64_t magic = kTxStampMagic;
+    if constexpr (std::endian::native == std::endian::big) {
+        magic = __builtin_bswap64(magic);
+        tsc = __builtin_bswap64(tsc);
+    }
+    std::memcpy(trailer, &magic, 8);
+    std::memcpy(trailer + 8, &tsc, 8);
+}
+
+// Strips a trailer from len if there is one and returns its TSC (0 if none
+// or not stamped yet).
+inline uint64_t take_tx_stamp(const uint8_t* payload, unsigned& len)
+{
+    if (len < kTxStampSize || len % kMdMessageSize != kTxStampSize) return 0;
+    uint64_t magic, tsc;
+    std::memcpy(&magic, payload + len - kTxStampSize, 8);
+    std::memcpy(&tsc, payload + len - 8, 8);
+    if constexpr (std::endian::native == std::endian::big) {
+        magic = __builtin_bswap64(magic);
+        tsc = __builtin_bswap64(tsc);
+    }
+    if (magic != kTxStampMagic) return 0;
+    len -= kTxStampSize;
+    return tsc;
+}
+
+// UDP payload of a frame that passed UdpFilter: pointer and length taken from
+// the UDP header, clipped to the frame. Returns false if the header lies.
+inline bool udp_payload(const uint8_t* pkt, uint16_t frame_len, const uint8_t*& payload, unsigned& len)
+{
+    const unsigned udp_off = 14u + (pkt[14] & 0x0fu) * 4u;
+    const unsigned udp_len = (unsigned)pkt[udp_off + 4] << 8 | pkt[udp_off + 5];
+    if (udp_len < 8 || udp_off + udp_len > frame_len) return false;
+    payload = pkt + udp_off + 8;
+    len = udp_len - 8;
+    return true;
+}
+
+struct SeqStats {
+    uint64_t messages = 0;  // delivered in sequence order
+    uint64_t gaps = 0;      // holes given up
+    uint64_t missing = 0;   // messages lost in those holes
+    uint64_t stale = 0;     // same-line repeats or arrivals after their gap was given up
+    uint64_t malformed = 0; // payloads that are not whole messages
+
+    void merge(const SeqStats& o)
+    {
+        messages += o.messages;
+        gaps += o.gaps;
+        missing += o.missing;
+        stale += o.stale;
+        malformed += o.malformed;
+    }
+};
+
+// Line arbitration for a feed published on up to kMaxLines redundant lines
+// (exchange A/B multicast). Every line carries the same sequence numbers.
+// - The first copy of each sequence number wins and is delivered; later
+//   copies from other lines are dropped as duplicates. The time between the
+//   two arrivals is recorded as the winning line's lead.
+// - Messages ahead of the next expected sequence number wait in a bounded gap
+//   buffer (kGapSlots), so a loss on one line is filled by the other without
+//   a gap. A gap is given up, and the buffered messages after it delivered,
+//   when it stays open for gap_timeout_ns (checked by expire()) or when a
+//   message arrives kGapSlots or more ahead.
+// With one line this is a reordering sequence tracker.
+// Callbacks: deliver(const MdMessage&, uint64_t rx_tsc) in sequence order,
+// gap(uint64_t first_missing, uint64_t count) for each range given up.
+class FeedArbiter {
+public:
+    static constexpr unsigned kMaxLines = 4;
+    static constexpr uint64_t kGapSlots = 1024; // messages held while a gap is open
+    static constexpr uint64_t kHistory = 4096;  // first arrivals remembered for duplicate matching
+
+    struct LineStats {
+        uint64_t received = 0;   // messages seen on this line
+        uint64_t first = 0;      // copies that won arbitration
+        uint64_t duplicates = 0; // copies that lost to another line
+        HdrHistogram lead;       // ns this line's copy was ahead of the losing copy
+    };
+
+    FeedArbiter(unsigned lines, uint64_t gap_timeout_ns)
+        : clk_(TscClock::instance()), nlines_(lines), gap_(kGapSlots), seen_(kHistory)
+    {
+        gap_timeout_ = clk_.from_ns(gap_timeout_ns);
+    }
+
+    template<typename Deliver, typename OnGap>
+    void on_message(unsigned line, const MdMessage& m, uint64_t rx_tsc, Deliver&& deliver, OnGap&& gap)
+    {
+        LineStats& ls = lines_[line];
+        ++ls.received;
+        if (!started_) {
+            started_ = true;
+            expected_ = m.seq;
+        }
+        Seen& h = seen_[m.seq % kHistory];
+        if (h.seq == m.seq) {
+            if (h.line != line) {
+                ++ls.duplicates;
+                lines_[h.line].lead.record(rx_tsc > h.tsc ? clk_.to_ns(rx_tsc - h.tsc) : 0);
+            } else {
+                ++stats_.stale;
+            }
+            return;
+        }
+        if (m.seq < expected_) { // older than the history, or part of a gap already given up
+            ++stats_.stale;
+            return;
+        }
+        h = Seen{m.seq, rx_tsc, (uint8_t)line};
+        ++ls.first;
+        if (m.seq - expected_ >= kGapSlots) {
+            // too far ahead to buffer: give up the oldest holes; the drain
+            // may bring expected_ all the way up to this message
+            skip_to(m.seq - kGapSlots + 1, deliver, gap);
+            drain(rx_tsc, deliver);
+        }
+        if (m.seq == expected_) {
+            ++stats_.messages;
+            ++expected_;
+            deliver(m, rx_tsc);
+            if (buffered_) drain(rx_tsc, deliver);
+            return;
+        }
+        gap_[m.seq % kGapSlots] = Slot{m, rx_tsc, true};
+        if (buffered_++ == 0) gap_since_ = rx_tsc;
+    }
+
+    bool gap_open() const { return buffered_ != 0; }
+
+    // Gives up the current gap if it has been open longer than the timeout.
+    template<typename Deliver, typename OnGap>
+    void expire(uint64_t now_tsc, Deliver&& deliver, OnGap&& gap)
+    {
+        if (!buffered_ || now_tsc - gap_since_ < gap_timeout_) return;
+        uint64_t next = expected_;
+        while (!(gap_[next % kGapSlots].used && gap_[next % kGapSlots].m.seq == next)) ++next;
+        skip_to(next, deliver, gap);
+        drain(now_tsc, deliver);
+    }
+
+    void malformed() { ++stats_.malformed; }
+    uint64_t expected() const { return expected_; }
+    unsigned lines() const { return nlines_; }
+    const SeqStats& stats() const { return stats_; }
+    const LineStats& line(unsigned i) const { return lines_[i]; }
+
+private:
+    struct Slot {
+        MdMessage m;
+        uint64_t rx_tsc;
+        bool used;
+    };
+    struct Seen {
+        uint64_t seq = UINT64_MAX;
+        uint64_t tsc = 0;
+        uint8_t line = 0;
+    };
+
+    template<typename Deliver>
+    void drain(uint64_t now_tsc, Deliver& deliver)
+    {
+        for (;;) {
+            Slot& s = gap_[expected_ % kGapSlots];
+            if (!s.used || s.m.seq != expected_) break;
+            s.used = false;
+            --buffered_;
+            ++stats_.messages;
+            ++expected_;
+            deliver(s.m, s.rx_tsc);
+        }
+        gap_since_ = now_tsc; // a remaining hole is a new gap
+    }
+
+    // Moves expected_ to seq, delivering buffered messages on the way and
+    // reporting the holes between them.
+    template<typename Deliver, typename OnGap>
+    void skip_to(uint64_t seq, Deliver& deliver, OnGap& gap)
+    {
+        uint64_t hole = 0;
+        while (expected_ < seq) {
+            if (buffered_ == 0) { // nothing held: jump straight there
+                hole += seq - expected_;
+                expected_ = seq;
+                break;
+            }
+            Slot& s = gap_[expected_ % kGapSlots];
+            if (s.used && s.m.seq == expected_) {
+                if (hole) report_gap(expected_ - hole, hole, gap);
+                hole = 0;
+                s.used = false;
+                --buffered_;
+                ++stats_.messages;
+                deliver(s.m, s.rx_tsc);
+            } else {
+                ++hole;
+            }
+            ++expected_;
+        }
+        if (hole) report_gap(expected_ - hole, hole, gap);
+    }
+
+    template<typename OnGap>
+    void report_gap(uint64_t first, uint64_t count, OnGap& gap)
+    {
+        ++stats_.gaps;
+        stats_.missing += count;
+        gap(first, count);
+    }
+
+    const TscClock& clk_;
+    unsigned nlines_;
+    uint64_t gap_timeout_ = 0;
+    bool started_ = false;
+    uint64_t expected_ = 0;
+    uint64_t buffered_ = 0;
+    uint64_t gap_since_ = 0;
+    std::vector<Slot> gap_;
+    std::vector<Seen> seen_;
+    LineStats lines_[kMaxLines];
+    SeqStats stats_;
+};
+
+// Consumer ("strategy") thread fed by one receive core through an SPSC ring.
+// It busy-polls the ring on its own core, keeps the last price/qty per symbol
+// and records wire-to-consumer latency (now - rx_tsc) in a histogram.
+// The producer side counts ring-full drops itself (push() returned false).
+class FeedConsumer {
+public:
+    static constexpr size_t kRingSize = 16384;
+    static constexpr uint32_t kSymbols = 65536; // book slots, indexed by symbol id modulo this
+    using Ring = FixedRingBuffer<MdEvent, kRingSize>;
+
+    struct Level {
+        int64_t price = 0;
+        uint32_t qty = 0;
+        uint32_t updates = 0;
+    };
+
+    // cpu: core to pin the thread to, -1 = not pinned.
+    explicit FeedConsumer(int cpu = -1) : cpu_(cpu), clk_(TscClock::instance()), book_(kSymbols) {}
+    ~FeedConsumer() { stop(); }
+
+    FeedConsumer(const FeedConsumer&) = delete;
+    FeedConsumer& operator=(const FeedConsumer&) = delete;
+
+    Ring& ring() { return ring_; }
+
+    void start()
+    {
+        running_.store(true, std::memory_order_release);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Drains what is still queued, then joins.
+    void stop()
+    {
+        if (!thread_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        thread_.join();
+    }
+
+    // Valid after stop().
+    uint64_t consumed() const { return consumed_; }
+    const HdrHistogram& latency() const { return latency_; }
+    const Level& level(uint32_t symbol) const { return book_[symbol % kSymbols]; }
+
+private:
+    void run()
+    {
+        if (cpu_ >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu_, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                std::fprintf(stderr, "Warning: could not pin feed consumer to cpu %d\n", cpu_);
+        }
+        for (;;) {
+            const bool running = running_.load(std::memory_order_acquire);
+            bool any = false;
+            while (auto e = ring_.pop()) {
+                on_event(*e);
+                any = true;
+            }
+            if (any) continue;
+            if (!running) break;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+
+    void on_event(const MdEvent& e)
+    {
+        const uint64_t now = clk_.now();
+        latency_.record(now > e.rx_tsc ? clk_.to_ns(now - e.rx_tsc) : 0);
+        Level& l = book_[e.symbol % kSymbols];
+        l.price = e.price;
+        l.qty = e.qty;
+        ++l.updates;
+        ++consumed_;
+    }
+
+    int cpu_;
+    const TscClock& clk_;
+    Ring ring_;
+    std::vector<Level> book_;
+    HdrHistogram latency_;
+    uint64_t consumed_ = 0;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
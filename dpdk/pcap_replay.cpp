@@ -0,0 +1,192 @@
+// Feed replay generator over a UDP socket: the reproducible load for
+// sock_recv and dpdk_recv benchmarks (replay.h has the DPDK-free core).
+//   pcap_replay -r feed.pcap -i 239.1.1.1 -t 40000 --timing original --speed 10
+//   pcap_replay --synth 100000 --msgs-per-pkt 4 --timing pps --pps 200000 --iface lo
+// Each line (-i/-t, then every --line) gets its own copy of every packet, so
+// two lines make an A/B feed; --loss drops packets per line to exercise the
+// arbiter. Packets carry a send-TSC trailer (md_feed.h) stamped right before
+// sendmmsg; a receiver on the same host reports one-way latency from it.
+
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_report.h"
+#include "feed_handler.h"
+#include "replay.h"
+
+static std::atomic<bool> keep_running{true};
+
+static void
+signal_handler(int signum)
+{
+    (void)signum;
+    keep_running.store(false, std::memory_order_relaxed);
+}
+
+static int open_send_socket(const std::string& iface, int ttl)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "socket() failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    const unsigned char loop = 1, mttl = (unsigned char)ttl;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)); // same-host receivers
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &mttl, sizeof(mttl));
+    if (!iface.empty()) {
+        struct ip_mreqn mreq;
+        std::memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_ifindex = (int)if_nametoindex(iface.c_str());
+        if (mreq.imr_ifindex == 0 || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) != 0) {
+            std::cerr << "Cannot send multicast on " << iface << ": " << std::strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+int main(int argc, char** argv)
+{
+    ReplayOptions o;
+    std::string iface;
+    int ttl = 1;
+    std::string save_path;
+
+    enum { OPT_IFACE = kReplayOptEnd, OPT_TTL, OPT_SAVE };
+    auto on_extra = [&](int opt, const char* arg) {
+        switch (opt) {
+            case OPT_IFACE: iface = arg; break;
+            case OPT_TTL: ttl = std::clamp(atoi(arg), 0, 255); break;
+            case OPT_SAVE: save_path = arg; break;
+            default: break;
+        }
+        return true;
+    };
+    if (!parse_replay_args(argc, argv, "",
+                           {{"iface", required_argument, nullptr, OPT_IFACE},
+                            {"ttl", required_argument, nullptr, OPT_TTL},
+                            {"save", required_argument, nullptr, OPT_SAVE}},
+                           on_extra, "Usage: pcap_replay (-r FILE.pcap | --synth N) [-i IP -t PORT] [--line IP:PORT]...",
+                           o))
+        return 1;
+
+    ReplayFeed feed;
+    if (!load_replay_feed(o, feed)) return 1;
+    const size_t nframes = feed.size();
+    if (!save_path.empty()) {
+        // line A as it would go out (unstamped trailer), e.g. for dpdk_recv with
+        // --vdev 'net_pcap0,rx_pcap=FILE'
+        std::vector<PcapRecord> out;
+        for (const ReplayFrame& f : feed.frames[0])
+            if (!f.drop) out.push_back(PcapRecord{f.ts_ns, f.frame});
+        std::string err;
+        if (!write_pcap(save_path, out, err)) {
+            std::cerr << err << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << out.size() << " packets to " << save_path << std::endl;
+        return 0;
+    }
+
+    const int fd = open_send_socket(iface, ttl);
+    if (fd < 0) return 1;
+    std::vector<struct sockaddr_in> dst(o.lines.size());
+    for (size_t l = 0; l < o.lines.size(); ++l) {
+        std::memset(&dst[l], 0, sizeof(dst[l]));
+        dst[l].sin_family = AF_INET;
+        dst[l].sin_addr.s_addr = htonl(o.lines[l].ip);
+        dst[l].sin_port = htons(o.lines[l].port);
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (o.format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::cout << "Replaying " << nframes << " packets";
+    if (feed.skipped) std::cout << " (" << feed.skipped << " non-UDP skipped)";
+    std::cout << " to";
+    for (size_t i = 0; i < o.lines.size(); ++i) std::cout << " " << (char)('A' + i) << "=" << o.lines[i].name;
+    std::cout << ", timing ";
+    if (o.timing == ReplayTiming::Original) std::cout << "original x" << o.speed;
+    else if (o.timing == ReplayTiming::Pps) std::cout << (uint64_t)o.pps << " pps";
+    else std::cout << "max";
+    std::cout << ", " << (o.loops ? std::to_string(o.loops) : std::string("unlimited")) << " loop(s)" << std::endl;
+
+    const TscClock& clk = TscClock::instance();
+    ReplayPacer pacer(o.timing, o.pps, o.speed, feed.frames[0]);
+    const unsigned max_msgs = o.batch * (unsigned)o.lines.size();
+    std::vector<struct iovec> iov(max_msgs);
+    std::vector<struct mmsghdr> msgs(max_msgs);
+    std::vector<ReplayFrame*> batch(max_msgs);
+    unsigned n = 0;
+    uint64_t sent = 0, send_errors = 0, send_calls = 0;
+
+    auto add = [&](unsigned l, ReplayFrame& f) {
+        iov[n].iov_base = f.frame.data() + f.payload_off;
+        iov[n].iov_len = f.payload_len;
+        std::memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+        msgs[n].msg_hdr.msg_name = &dst[l];
+        msgs[n].msg_hdr.msg_namelen = sizeof(dst[l]);
+        msgs[n].msg_hdr.msg_iov = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        batch[n++] = &f;
+    };
+    // everything already due goes out in the same sendmmsg
+    auto send = [&](uint64_t now) {
+        for (unsigned j = 0; j < n; ++j)
+            if (batch[j]->stamp_off >= 0) put_tx_stamp(batch[j]->frame.data() + batch[j]->stamp_off, now);
+        for (unsigned off = 0; off < n;) {
+            const int rc = sendmmsg(fd, msgs.data() + off, n - off, 0);
+            ++send_calls;
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                ++send_errors; // e.g. ENOBUFS: count it and move on rather than stall the schedule
+                ++off;
+                continue;
+            }
+            off += (unsigned)rc;
+            sent += (unsigned)rc;
+        }
+        n = 0;
+    };
+    const ReplayProgress progress = replay_frames(
+        o, feed, pacer, [] { return keep_running.load(std::memory_order_relaxed); }, add, send);
+    const uint64_t elapsed_ns = clk.to_ns(clk.now() - pacer.start());
+    close(fd);
+
+    const double secs = (double)elapsed_ns / 1e9;
+    const double rate = secs > 0 ? (double)sent / secs : 0.0;
+    std::cout << "Sent " << sent << " packets in " << secs << " s (" << (uint64_t)rate << " pps, "
+              << (send_calls ? (double)sent / (double)send_calls : 0.0) << " per sendmmsg)";
+    if (progress.dropped) std::cout << ", dropped by --loss: " << progress.dropped;
+    if (send_errors) std::cout << ", send errors: " << send_errors;
+    std::cout << std::endl;
+    if (o.timing != ReplayTiming::Max) {
+        std::cout << "Pacing: late (>10us behind schedule)=" << pacer.late_frames()
+                  << " max lag=" << pacer.max_lag_ns() << "ns" << std::endl;
+    }
+
+    BenchReport report("pcap_replay");
+    report_replay(report, o, progress.loops, sent, rate, pacer);
+    report.metric("tx", "send_errors", (double)send_errors, "count", Better::Lower);
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, o.format);
+    return 0;
+}
@@ -0,0 +1,560 @@
+#pragma once
+#include <getopt.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_report.h"
+#include "feed_handler.h"
+#include "md_feed.h"
+#include "open_loop.h"
+#include "tsc_clock.h"
+
+// Replay generator core shared by pcap_replay (UDP socket) and dpdk_replay
+// (DPDK TX queue). No DPDK types.
+// - Classic pcap files (microsecond or nanosecond, either byte order,
+//   Ethernet link type) are read completely into memory before sending.
+// - Every IPv4/UDP frame is rewritten to the destination group:port (and its
+//   multicast MAC), optionally with room for a send-stamp trailer
+//   (md_feed.h), and its IPv4 checksum is recomputed; the UDP checksum is
+//   cleared. Other frames are skipped.
+// - ReplayPacer spaces sends by the capture timestamps (optionally sped up),
+//   at a fixed rate, or not at all.
+// - The command line, frame preparation, batch loop and report are shared
+//   too (parse_replay_args, load_replay_feed, replay_frames, report_replay);
+//   the tools only differ in how a batch reaches the wire.
+
+struct PcapRecord {
+    uint64_t ts_ns;
+    std::vector<uint8_t> data;
+};
+
+namespace pcap_detail {
+constexpr uint32_t kMagicUs = 0xa1b2c3d4;
+constexpr uint32_t kMagicNs = 0xa1b23c4d;
+constexpr uint32_t kLinkEthernet = 1;
+
+inline uint32_t swap32(uint32_t v, bool swap) { return swap ? __builtin_bswap32(v) : v; }
+} // namespace pcap_detail
+
+inline bool read_pcap(const std::string& path, std::vector<PcapRecord>& out, std::string& err)
+{
+    using namespace pcap_detail;
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        err = "cannot open " + path;
+        return false;
+    }
+    uint32_t hdr[6];
+    if (std::fread(hdr, sizeof(hdr), 1, f) != 1) {
+        std::fclose(f);
+        err = path + ": short pcap header";
+        return false;
+    }
+    bool swap = false, nsec = false;
+    if (hdr[0] == kMagicUs || hdr[0] == kMagicNs) {
+        nsec = hdr[0] == kMagicNs;
+    } else if (hdr[0] == __builtin_bswap32(kMagicUs) || hdr[0] == __builtin_bswap32(kMagicNs)) {
+        swap = true;
+        nsec = hdr[0] == __builtin_bswap32(kMagicNs);
+    } else {
+        std::fclose(f);
+        err = path + ": not a pcap file (pcapng is not supported)";
+        return false;
+    }
+    if (swap32(hdr[5], swap) != kLinkEthernet) {
+        std::fclose(f);
+        err = path + ": link type " + std::to_string(swap32(hdr[5], swap)) + " is not Ethernet";
+        return false;
+    }
+    uint32_t rec[4];
+    while (std::fread(rec, sizeof(rec), 1, f) == 1) {
+        const uint32_t caplen = swap32(rec[2], swap);
+        if (caplen > 262144) {
+            std::fclose(f);
+            err = path + ": corrupt record length";
+            return false;
+        }
+        PcapRecord r;
+        r.ts_ns = (uint64_t)swap32(rec[0], swap) * 1000000000ull + (uint64_t)swap32(rec[1], swap) * (nsec ? 1 : 1000);
+        r.data.resize(caplen);
+        if (caplen && std::fread(r.data.data(), caplen, 1, f) != 1) break; // truncated capture: keep what we have
+        out.push_back(std::move(r));
+    }
+    std::fclose(f);
+    return true;
+}
+
+inline bool write_pcap(const std::string& path, const std::vector<PcapRecord>& recs, std::string& err)
+{
+    using namespace pcap_detail;
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        err = "cannot create " + path;
+        return false;
+    }
+    const uint32_t hdr[6] = {kMagicNs, 0x00040002u /* version 2.4 */, 0, 0, 65535, kLinkEthernet};
+    bool ok = std::fwrite(hdr, sizeof(hdr), 1, f) == 1;
+    for (const PcapRecord& r : recs) {
+        const uint32_t rec[4] = {(uint32_t)(r.ts_ns / 1000000000ull), (uint32_t)(r.ts_ns % 1000000000ull),
+                                 (uint32_t)r.data.size(), (uint32_t)r.data.size()};
+        ok = ok && std::fwrite(rec, sizeof(rec), 1, f) == 1;
+        ok = ok && (r.data.empty() || std::fwrite(r.data.data(), r.data.size(), 1, f) == 1);
+    }
+    if (std::fclose(f) != 0) ok = false;
+    if (!ok) err = "write to " + path + " failed";
+    return ok;
+}
+
+inline uint16_t ipv4_checksum(const uint8_t* h, unsigned len)
+{
+    uint32_t sum = 0;
+    for (unsigned i = 0; i + 1 < len; i += 2) sum += (uint32_t)h[i] << 8 | h[i + 1];
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+// A synthetic feed in the md_feed.h format: count frames with msgs_per_pkt
+// messages each, sequence numbers from 1, spaced gap_ns apart.
+inline std::vector<PcapRecord> synth_feed(uint64_t count, unsigned msgs_per_pkt, uint64_t gap_ns)
+{
+    std::vector<PcapRecord> out;
+    out.reserve(count);
+    uint64_t seq = 1;
+    for (uint64_t i = 0; i < count; ++i) {
+        const unsigned payload = msgs_per_pkt * kMdMessageSize;
+        PcapRecord r;
+        r.ts_ns = i * gap_ns;
+        r.data.assign(14 + 20 + 8 + payload, 0);
+        uint8_t* p = r.data.data();
+        p[12] = 0x08; // IPv4; the destination is filled in by prepare_frames()
+        p[14] = 0x45;
+        p[14 + 8] = 64;  // TTL
+        p[14 + 9] = 17;  // UDP
+        p[26] = 10, p[29] = 1;            // src 10.0.0.1
+        p[34] = 0x9c, p[35] = 0x40;       // src port 40000
+        for (unsigned m = 0; m < msgs_per_pkt; ++m, ++seq) {
+            const MdMessage msg{seq, (uint32_t)(seq % 100), (uint32_t)(100 + seq % 7), (int64_t)(10000000000ll + (int64_t)(seq % 1000) * 1000000)};
+            encode_md_message(p + 42 + m * kMdMessageSize, msg);
+        }
+        const unsigned ip_len = 20 + 8 + payload;
+        p[16] = (uint8_t)(ip_len >> 8), p[17] = (uint8_t)ip_len;
+        p[38] = (uint8_t)((8 + payload) >> 8), p[39] = (uint8_t)(8 + payload);
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+// One frame ready to send to one line.
+struct ReplayFrame {
+    std::vector<uint8_t> frame; // Ethernet frame, rewritten
+    uint64_t ts_ns;             // capture time relative to the first frame
+    unsigned payload_off;       // UDP payload (for the socket sender)
+    unsigned payload_len;       // including the stamp trailer
+    int stamp_off;              // trailer offset in frame, -1 = not stamped
+    bool drop;                  // lost on this line (--loss): paced but not sent
+};
+
+struct RewriteOptions {
+    uint32_t dst_ip = 0;   // host order, 0 = keep
+    uint16_t dst_port = 0; // 0 = keep
+    bool stamp = true;     // reserve a send-stamp trailer
+    double loss = 0.0;     // mark this fraction of frames dropped (per line, for A/B tests)
+    uint32_t seed = 1;
+};
+
+// Rewrites recs for one destination. Returns the number of frames skipped
+// (not IPv4/UDP or truncated). Every line prepared from the same records gets
+// the same frame count, so frame i is the same packet on every line.
+inline uint64_t prepare_frames(const std::vector<PcapRecord>& recs, const RewriteOptions& o,
+                               std::vector<ReplayFrame>& out)
+{
+    uint64_t skipped = 0;
+    std::mt19937 rng(o.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    const uint64_t t0 = recs.empty() ? 0 : recs.front().ts_ns;
+    for (const PcapRecord& r : recs) {
+        const uint8_t* p = r.data.data();
+        const size_t n = r.data.size();
+        if (n < 14 + 20 + 8 || p[12] != 0x08 || p[13] != 0x00 || (p[14] >> 4) != 4 || p[14 + 9] != 17) {
+            ++skipped;
+            continue;
+        }
+        const unsigned ihl = (p[14] & 0x0fu) * 4u;
+        const unsigned ip_len = (unsigned)p[16] << 8 | p[17];
+        if (ihl < 20 || ip_len < ihl + 8 || 14u + ip_len > n) {
+            ++skipped;
+            continue;
+        }
+        ReplayFrame f;
+        f.drop = o.loss > 0.0 && coin(rng) < o.loss;
+        f.ts_ns = r.ts_ns - std::min(r.ts_ns, t0);
+        f.frame.assign(p, p + 14 + ip_len); // drops Ethernet padding
+        const unsigned extra = o.stamp ? kTxStampSize : 0;
+        f.frame.resize(f.frame.size() + extra, 0);
+        uint8_t* ip = f.frame.data() + 14;
+        uint8_t* udp = ip + ihl;
+        const unsigned new_ip_len = ip_len + extra;
+        const unsigned udp_len = new_ip_len - ihl;
+        ip[2] = (uint8_t)(new_ip_len >> 8), ip[3] = (uint8_t)new_ip_len;
+        udp[4] = (uint8_t)(udp_len >> 8), udp[5] = (uint8_t)udp_len;
+        udp[6] = udp[7] = 0; // no UDP checksum
+        if (o.dst_ip) {
+            ip[16] = (uint8_t)(o.dst_ip >> 24), ip[17] = (uint8_t)(o.dst_ip >> 16);
+            ip[18] = (uint8_t)(o.dst_ip >> 8), ip[19] = (uint8_t)o.dst_ip;
+        }
+        if (o.dst_port) udp[2] = (uint8_t)(o.dst_port >> 8), udp[3] = (uint8_t)o.dst_port;
+        if (ip[16] >> 4 == 0xE) { // multicast destination MAC: 01:00:5e + low 23 bits
+            uint8_t* mac = f.frame.data();
+            mac[0] = 0x01, mac[1] = 0x00, mac[2] = 0x5e;
+            mac[3] = ip[17] & 0x7f, mac[4] = ip[18], mac[5] = ip[19];
+        }
+        ip[10] = ip[11] = 0;
+        const uint16_t csum = ipv4_checksum(ip, ihl);
+        ip[10] = (uint8_t)(csum >> 8), ip[11] = (uint8_t)csum;
+
+        f.payload_off = 14 + ihl + 8;
+        f.payload_len = udp_len - 8;
+        f.stamp_off = o.stamp ? (int)(f.frame.size() - kTxStampSize) : -1;
+        if (o.stamp) put_tx_stamp(f.frame.data() + f.stamp_off, 0);
+        out.push_back(std::move(f));
+    }
+    return skipped;
+}
+
+// Sequence range of a capture in the md_feed.h format (0 if any payload is
+// not whole messages). Looping senders add it to every message once per loop
+// so the receiver sees one continuous feed instead of repeats.
+inline uint64_t md_seq_span(const std::vector<ReplayFrame>& frames)
+{
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (const ReplayFrame& f : frames) {
+        const unsigned len = f.payload_len - (f.stamp_off >= 0 ? kTxStampSize : 0);
+        if (len == 0 || len % kMdMessageSize != 0) return 0;
+        for (unsigned off = 0; off < len; off += kMdMessageSize) {
+            const uint64_t seq = decode_md_message(f.frame.data() + f.payload_off + off).seq;
+            lo = std::min(lo, seq);
+            hi = std::max(hi, seq);
+        }
+    }
+    return lo <= hi ? hi - lo + 1 : 0;
+}
+
+inline void advance_md_seq(ReplayFrame& f, uint64_t delta)
+{
+    const unsigned len = f.payload_len - (f.stamp_off >= 0 ? kTxStampSize : 0);
+    for (unsigned off = 0; off < len; off += kMdMessageSize) {
+        uint8_t* p = f.frame.data() + f.payload_off + off;
+        MdMessage m = decode_md_message(p);
+        m.seq += delta;
+        encode_md_message(p, m);
+    }
+}
+
+enum class ReplayTiming { Original, Pps, Max };
+
+// Due times for the frames of a replay. Frame i of loop l is due at
+//   Original: start + (ts_ns[i] + l * loop_span) / speed
+//   Pps:      start + (l * frames + i) / pps
+//   Max:      now (never waits)
+// Lag behind the due time is tracked like OpenLoopSchedule does.
+class ReplayPacer {
+public:
+    ReplayPacer(ReplayTiming t, double pps, double speed, const std::vector<ReplayFrame>& frames)
+        : clk_(TscClock::instance()), timing_(t), speed_(speed > 0 ? speed : 1.0), frames_(frames)
+    {
+        if (t == ReplayTiming::Pps) sched_ = OpenLoopSchedule(clk_, pps);
+        if (!frames.empty()) {
+            // one average inter-frame gap between the last frame and the next loop's first
+            const uint64_t span = frames.back().ts_ns;
+            loop_span_ns_ = span + (frames.size() > 1 ? span / (frames.size() - 1) : 1000);
+        }
+        start_ = clk_.now();
+    }
+
+    // Due time of frame i of loop l, in ticks.
+    uint64_t due(uint64_t l, size_t i) const
+    {
+        switch (timing_) {
+            case ReplayTiming::Original:
+                return start_ + clk_.from_ns((uint64_t)((double)(frames_[i].ts_ns + l * loop_span_ns_) / speed_));
+            case ReplayTiming::Pps: return sched_.due(l * frames_.size() + i);
+            case ReplayTiming::Max: break;
+        }
+        return 0;
+    }
+
+    // Spins until due; returns the current TSC.
+    uint64_t wait(uint64_t due_ticks)
+    {
+        uint64_t now = clk_.now();
+        while (now < due_ticks) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            now = clk_.now();
+        }
+        return now;
+    }
+
+    void note_issue(uint64_t due_ticks, uint64_t now)
+    {
+        if (timing_ == ReplayTiming::Max) return;
+        const uint64_t lag = now > due_ticks ? now - due_ticks : 0;
+        max_lag_ = std::max(max_lag_, lag);
+        if (lag >= late_threshold_) ++late_;
+    }
+
+    uint64_t late_frames() const { return late_; }
+    uint64_t max_lag_ns() const { return clk_.to_ns(max_lag_); }
+    uint64_t start() const { return start_; }
+
+private:
+    const TscClock& clk_;
+    ReplayTiming timing_;
+    double speed_;
+    const std::vector<ReplayFrame>& frames_;
+    OpenLoopSchedule sched_;
+    uint64_t loop_span_ns_ = 0;
+    uint64_t start_ = 0;
+    uint64_t late_ = 0;
+    uint64_t max_lag_ = 0;
+    uint64_t late_threshold_ = clk_.from_ns(10000); // 10us behind counts as late
+};
+
+inline const char* replay_timing_name(ReplayTiming t)
+{
+    return t == ReplayTiming::Original ? "original" : t == ReplayTiming::Pps ? "pps" : "max";
+}
+
+// Command line shared by pcap_replay and dpdk_replay.
+struct ReplayOptions {
+    std::string pcap_path;
+    std::vector<FeedLine> lines; // line A (-i/-t) first, then every --line
+    ReplayTiming timing = ReplayTiming::Original;
+    double pps = 100000.0;
+    double speed = 1.0;
+    uint64_t loops = 1; // 0 = until interrupted
+    unsigned batch = 32;
+    uint64_t synth = 0;
+    unsigned msgs_per_pkt = 1;
+    bool stamp = true;
+    double loss = 0.0;
+    uint32_t seed = 1;
+    ReportFormat format = ReportFormat::Text;
+};
+
+enum {
+    OPT_REPLAY_LINE = 256,
+    OPT_REPLAY_TIMING,
+    OPT_REPLAY_PPS,
+    OPT_REPLAY_SPEED,
+    OPT_REPLAY_LOOPS,
+    OPT_REPLAY_BATCH,
+    OPT_REPLAY_SYNTH,
+    OPT_REPLAY_MSGS_PER_PKT,
+    OPT_REPLAY_NO_STAMP,
+    OPT_REPLAY_LOSS,
+    OPT_REPLAY_SEED,
+    OPT_REPLAY_FORMAT,
+    kReplayOptEnd // a tool numbers its own long options from here
+};
+
+// Parses the shared options plus the tool's own (extra_short, extra_long),
+// which are handed to on_extra(opt, optarg); it returns false for a bad
+// value. Prints an error (or usage) and returns false when the tool should
+// exit.
+template<typename OnExtra>
+inline bool parse_replay_args(int argc, char** argv, const char* extra_short,
+                              std::initializer_list<struct option> extra_long, OnExtra on_extra, const char* usage,
+                              ReplayOptions& o)
+{
+    std::string target_ip_str = "224.0.0.100";
+    uint32_t target_ip = parse_ipv4_addr("224.0.0.100");
+    uint16_t target_port = 40000;
+    std::vector<FeedLine> extra_lines;
+
+    std::vector<struct option> longopts = {
+        {"read", required_argument, nullptr, 'r'},
+        {"target-ip", required_argument, nullptr, 'i'},
+        {"target-port", required_argument, nullptr, 't'},
+        {"line", required_argument, nullptr, OPT_REPLAY_LINE},
+        {"timing", required_argument, nullptr, OPT_REPLAY_TIMING}, // original, pps, max
+        {"pps", required_argument, nullptr, OPT_REPLAY_PPS},
+        {"speed", required_argument, nullptr, OPT_REPLAY_SPEED},
+        {"loops", required_argument, nullptr, OPT_REPLAY_LOOPS},
+        {"batch", required_argument, nullptr, OPT_REPLAY_BATCH},
+        {"synth", required_argument, nullptr, OPT_REPLAY_SYNTH},
+        {"msgs-per-pkt", required_argument, nullptr, OPT_REPLAY_MSGS_PER_PKT},
+        {"no-stamp", no_argument, nullptr, OPT_REPLAY_NO_STAMP},
+        {"loss", required_argument, nullptr, OPT_REPLAY_LOSS},
+        {"seed", required_argument, nullptr, OPT_REPLAY_SEED},
+        {"format", required_argument, nullptr, OPT_REPLAY_FORMAT},
+    };
+    longopts.insert(longopts.end(), extra_long.begin(), extra_long.end());
+    longopts.push_back({0,0,0,0});
+    const std::string shortopts = std::string("r:i:t:") + extra_short;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortopts.c_str(), longopts.data(), nullptr)) != -1) {
+        switch (opt) {
+            case 'r': o.pcap_path = optarg; break;
+            case 'i': target_ip_str = optarg; target_ip = parse_ipv4_addr(optarg); break;
+            case 't': target_port = (uint16_t)atoi(optarg); break;
+            case OPT_REPLAY_LINE: {
+                FeedLine l;
+                if (!parse_line(optarg, l)) {
+                    std::cerr << "Bad --line '" << optarg << "' (expected IP:PORT)" << std::endl;
+                    return false;
+                }
+                extra_lines.push_back(l);
+                break;
+            }
+            case OPT_REPLAY_TIMING:
+                if (std::strcmp(optarg, "original") == 0) o.timing = ReplayTiming::Original;
+                else if (std::strcmp(optarg, "pps") == 0) o.timing = ReplayTiming::Pps;
+                else if (std::strcmp(optarg, "max") == 0) o.timing = ReplayTiming::Max;
+                else {
+                    std::cerr << "Unknown timing '" << optarg << "' (expected original, pps or max)" << std::endl;
+                    return false;
+                }
+                break;
+            case OPT_REPLAY_PPS: o.pps = std::max(1.0, atof(optarg)); o.timing = ReplayTiming::Pps; break;
+            case OPT_REPLAY_SPEED: o.speed = atof(optarg); break;
+            case OPT_REPLAY_LOOPS: o.loops = std::strtoull(optarg, nullptr, 10); break;
+            case OPT_REPLAY_BATCH: o.batch = (unsigned)std::clamp(atoi(optarg), 1, 1024); break;
+            case OPT_REPLAY_SYNTH: o.synth = std::strtoull(optarg, nullptr, 10); break;
+            case OPT_REPLAY_MSGS_PER_PKT: o.msgs_per_pkt = (unsigned)std::clamp(atoi(optarg), 1, 60); break;
+            case OPT_REPLAY_NO_STAMP: o.stamp = false; break;
+            case OPT_REPLAY_LOSS: o.loss = std::clamp(atof(optarg), 0.0, 1.0); break;
+            case OPT_REPLAY_SEED: o.seed = (uint32_t)std::strtoul(optarg, nullptr, 10); break;
+            case OPT_REPLAY_FORMAT:
+                if (!parse_report_format(optarg, o.format)) {
+                    std::cerr << "Unknown format '" << optarg << "' (expected text, json or csv)" << std::endl;
+                    return false;
+                }
+                break;
+            default:
+                if (!on_extra(opt, optarg)) return false;
+                break;
+        }
+    }
+    if (o.pcap_path.empty() == (o.synth == 0)) {
+        std::cerr << usage << std::endl;
+        return false;
+    }
+    o.lines = {FeedLine{target_ip, target_port, target_ip_str + ":" + std::to_string(target_port)}};
+    o.lines.insert(o.lines.end(), extra_lines.begin(), extra_lines.end());
+    return true;
+}
+
+// The frames to replay on every line: frames[l][i] is packet i on line l.
+struct ReplayFeed {
+    std::vector<std::vector<ReplayFrame>> frames;
+    uint64_t skipped = 0;  // not IPv4/UDP or truncated
+    uint64_t seq_span = 0; // md_seq_span() of the capture
+    size_t size() const { return frames[0].size(); }
+};
+
+// Reads the capture (or synthesizes one) and prepares a copy for every line,
+// each with its own --loss pattern. Prints an error and returns false if
+// there is nothing to send.
+inline bool load_replay_feed(const ReplayOptions& o, ReplayFeed& feed)
+{
+    std::vector<PcapRecord> recs;
+    if (o.synth) {
+        recs = synth_feed(o.synth, o.msgs_per_pkt, 1000);
+    } else {
+        std::string err;
+        if (!read_pcap(o.pcap_path, recs, err)) {
+            std::cerr << err << std::endl;
+            return false;
+        }
+    }
+    feed.frames.assign(o.lines.size(), {});
+    for (size_t l = 0; l < o.lines.size(); ++l) {
+        RewriteOptions ro;
+        ro.dst_ip = o.lines[l].ip;
+        ro.dst_port = o.lines[l].port;
+        ro.stamp = o.stamp;
+        ro.loss = o.loss;
+        ro.seed = o.seed + (uint32_t)l; // independent loss per line
+        feed.skipped = prepare_frames(recs, ro, feed.frames[l]);
+    }
+    if (feed.size() == 0) {
+        std::cerr << "No IPv4/UDP packets to send (" << feed.skipped << " skipped)" << std::endl;
+        return false;
+    }
+    feed.seq_span = md_seq_span(feed.frames[0]);
+    return true;
+}
+
+struct ReplayProgress {
+    uint64_t loops = 0;   // loops started
+    uint64_t dropped = 0; // frames not sent because of --loss
+};
+
+// The send loop of both tools. Waits for the next due frame, then takes
+// every frame that is already due (up to o.batch) on every line: add(line,
+// frame) for each frame --loss does not drop, then send(now) once, after
+// the pacer has noted the issue time; send stamps and transmits what add
+// gathered. From the second loop on, message sequence numbers are advanced
+// by the capture's span so the feed continues instead of repeating.
+template<typename Running, typename Add, typename Send>
+inline ReplayProgress replay_frames(const ReplayOptions& o, ReplayFeed& feed, ReplayPacer& pacer, Running running,
+                                    Add add, Send send)
+{
+    const TscClock& clk = TscClock::instance();
+    const size_t nframes = feed.size();
+    ReplayProgress p;
+    for (; running() && (o.loops == 0 || p.loops < o.loops); ++p.loops) {
+        for (size_t i = 0; i < nframes && running();) {
+            uint64_t now = pacer.wait(pacer.due(p.loops, i));
+            size_t end = i + 1;
+            while (end < nframes && end - i < o.batch && pacer.due(p.loops, end) <= now) ++end;
+            for (size_t k = i; k < end; ++k) {
+                for (size_t l = 0; l < feed.frames.size(); ++l) {
+                    ReplayFrame& f = feed.frames[l][k];
+                    if (p.loops > 0 && feed.seq_span) advance_md_seq(f, feed.seq_span);
+                    if (f.drop) {
+                        ++p.dropped;
+                        continue;
+                    }
+                    add((unsigned)l, f);
+                }
+            }
+            now = clk.now();
+            for (size_t k = i; k < end; ++k) pacer.note_issue(pacer.due(p.loops, k), now);
+            send(now);
+            i = end;
+        }
+    }
+    return p;
+}
+
+// Options and metrics both tools report; the tools add their own.
+inline void report_replay(BenchReport& report, const ReplayOptions& o, uint64_t loops, uint64_t sent, double rate,
+                          const ReplayPacer& pacer)
+{
+    report.clock_source(TscClock::instance().source());
+    report.option("input", o.synth ? "synth:" + std::to_string(o.synth) : o.pcap_path);
+    report.option("lines", o.lines.size());
+    report.option("timing", replay_timing_name(o.timing));
+    report.option("pps", o.pps);
+    report.option("speed", o.speed);
+    report.option("loops", loops);
+    report.option("batch", o.batch);
+    report.option("stamp", o.stamp ? "yes" : "no");
+    report.option("loss", o.loss);
+    report.metric("tx", "packets", (double)sent, "count", Better::None);
+    report.metric("tx", "rate", rate, "pps", Better::Higher);
+    report.metric("pacing", "late", (double)pacer.late_frames(), "count", Better::Lower);
+    report.metric("pacing", "max_lag", (double)pacer.max_lag_ns(), "ns", Better::Lower);
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <rte_ethdev.h>
+#include <rte_mbuf.h>
+#include <rte_mbuf_dyn.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "tsc_clock.h"
+
+// Receive timestamps in the TSC domain, so they compare with clk.stop().
+// - Hardware: the NIC stamps each packet with its own clock (the RX
+//   timestamp dynfield). NicClockSync samples rte_eth_read_clock against
+//   the TSC, fits tsc = a + b * nic over the last kWindow samples by least
+//   squares, and maps each stamp through the fit. Offset and drift are both
+//   tracked, so the stamps stay usable over long runs.
+// - Software: a packet in a burst arrived after the previous poll started
+//   (unless that poll came back full and left a backlog) and before
+//   rx_burst returned. BurstStamper stamps each packet at its place in that
+//   window, assuming in-order, evenly spaced arrival. It also keeps the
+//   window width, which bounds the error of each stamp.
+// The stamp is stored in an mbuf dynfield (RxTscField); the legacy
+// m->timestamp / m->udata64 fields no longer exist in current DPDK.
+
+// Dynfields: the PMD's RX timestamp (NIC clock) and our TSC stamp.
+struct RxTscField {
+    int tsc_offset = -1;
+    int nic_offset = -1;
+    uint64_t nic_flag = 0; // ol_flags bit set when the NIC stamped the mbuf
+
+    // Call after rte_eal_init (and for hw, after the port was configured
+    // with RTE_ETH_RX_OFFLOAD_TIMESTAMP).
+    bool init(bool hw)
+    {
+        static const struct rte_mbuf_dynfield desc = {
+            .name = "rx_tsc_dynfield",
+            .size = sizeof(uint64_t),
+            .align = alignof(uint64_t),
+            .flags = 0,
+        };
+        tsc_offset = rte_mbuf_dynfield_register(&desc);
+        if (tsc_offset < 0) {
+            std::cerr << "Failed to register the rx_tsc mbuf dynfield" << std::endl;
+            return false;
+        }
+        if (hw && rte_mbuf_dyn_rx_timestamp_register(&nic_offset, &nic_flag) != 0) {
+            std::cerr << "Failed to register the RX timestamp dynfield" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t& tsc(struct rte_mbuf* m) const { return *RTE_MBUF_DYNFIELD(m, tsc_offset, uint64_t*); }
+
+    // NIC clock stamp, or false if the NIC did not stamp this mbuf.
+    bool nic(const struct rte_mbuf* m, uint64_t& out) const
+    {
+        if (nic_offset < 0 || !(m->ol_flags & nic_flag)) return false;
+        out = *RTE_MBUF_DYNFIELD(const_cast<struct rte_mbuf*>(m), nic_offset, uint64_t*);
+        return true;
+    }
+};
+
+// NIC clock -> TSC. The RX lcore owns it: it calls maybe_sample() once per
+// poll and to_tsc() per packet, so the fit needs no synchronisation.
+class NicClockSync {
+public:
+    static constexpr unsigned kWindow = 16;
+
+    NicClockSync(uint16_t port, uint64_t period_ns) : port_(port), clk_(TscClock::instance())
+    {
+        period_ = clk_.from_ns(period_ns);
+    }
+
+    // A few samples 2ms apart (spread out, so read jitter does not dominate
+    // the first slope), so to_tsc() is usable from the first packet.
+    bool prime(unsigned n = 5)
+    {
+        const uint64_t gap = clk_.from_ns(2000000);
+        for (unsigned i = 0; i < n; ++i) {
+            const uint64_t until = clk_.now() + gap;
+            sample();
+            while (i + 1 < n && clk_.now() < until) {
+            }
+        }
+        return count_ >= 2;
+    }
+
+    void maybe_sample(uint64_t now)
+    {
+        if (now >= next_) sample();
+    }
+
+    bool ready() const { return count_ >= 2; }
+
+    uint64_t to_tsc(uint64_t nic) const
+    {
+        const double d = (double)(int64_t)(nic - nic_ref_) * slope_;
+        return (uint64_t)((int64_t)tsc_ref_ + (int64_t)std::llround(d));
+    }
+
+    // TSC ticks per NIC tick, and how far that moved since the first fit over
+    // a full window.
+    double slope() const { return slope_; }
+    double drift_ppm() const { return first_slope_ > 0 ? (slope_ / first_slope_ - 1.0) * 1e6 : 0.0; }
+    uint64_t samples() const { return taken_; }
+    uint64_t rejected() const { return rejected_; }
+    // Largest |fit - sample| seen in a window, ns: how well the line fits.
+    uint64_t max_residual_ns() const { return clk_.to_ns(max_residual_); }
+    // Read uncertainty of the best sample (TSC ticks spent around one read), ns.
+    uint64_t best_read_ns() const { return clk_.to_ns(best_read_); }
+
+private:
+    struct Sample {
+        uint64_t nic;
+        uint64_t tsc; // midpoint of the read
+    };
+
+    void sample()
+    {
+        uint64_t nic;
+        const uint64_t t0 = clk_.start();
+        const int rc = rte_eth_read_clock(port_, &nic);
+        const uint64_t t1 = clk_.stop();
+        next_ = t1 + period_;
+        if (rc != 0) {
+            ++rejected_;
+            return;
+        }
+        const uint64_t read = t1 - t0;
+        // a read that took much longer than the best one was interrupted or
+        // stalled on the bus; its midpoint says little about when nic was latched
+        if (best_read_ && read > 4 * best_read_) {
+            ++rejected_;
+            return;
+        }
+        best_read_ = best_read_ ? std::min(best_read_, read) : read;
+        win_[head_] = Sample{nic, t0 + read / 2};
+        head_ = (head_ + 1) % kWindow;
+        count_ = std::min(count_ + 1, kWindow);
+        ++taken_;
+        fit();
+    }
+
+    // Least squares over the window, relative to the newest sample so the
+    // doubles only carry deltas.
+    void fit()
+    {
+        const Sample& ref = win_[(head_ + kWindow - 1) % kWindow];
+        if (count_ < 2) {
+            nic_ref_ = ref.nic;
+            tsc_ref_ = ref.tsc;
+            return;
+        }
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (unsigned i = 0; i < count_; ++i) {
+            const double x = (double)(int64_t)(win_[i].nic - ref.nic);
+            const double y = (double)(int64_t)(win_[i].tsc - ref.tsc);
+            sx += x, sy += y, sxx += x * x, sxy += x * y;
+        }
+        const double n = count_;
+        const double den = n * sxx - sx * sx;
+        if (den <= 0) return; // NIC clock not advancing
+        slope_ = (n * sxy - sx * sy) / den;
+        const double icept = (sy - slope_ * sx) / n;
+        nic_ref_ = ref.nic;
+        tsc_ref_ = (uint64_t)((int64_t)ref.tsc + (int64_t)std::llround(icept));
+        if (first_slope_ == 0 && count_ == kWindow) first_slope_ = slope_;
+        for (unsigned i = 0; i < count_; ++i) {
+            const int64_t r = (int64_t)(to_tsc(win_[i].nic) - win_[i].tsc);
+            max_residual_ = std::max(max_residual_, (uint64_t)std::llabs(r));
+        }
+    }
+
+    uint16_t port_;
+    const TscClock& clk_;
+    uint64_t period_;
+    uint64_t next_ = 0;
+    Sample win_[kWindow];
+    unsigned head_ = 0;
+    unsigned count_ = 0;
+    uint64_t taken_ = 0;
+    uint64_t rejected_ = 0;
+    uint64_t best_read_ = 0;
+    uint64_t max_residual_ = 0;
+    double slope_ = 0.0;
+    double first_slope_ = 0.0;
+    uint64_t nic_ref_ = 0;
+    uint64_t tsc_ref_ = 0;
+};
+
+// Software stamps for one RX queue: call begin() with the TSC read before
+// every rx_burst, then idle() if it came back empty, or end() with the count
+// and the TSC after it followed by stamp(i) per packet.
+class BurstStamper {
+public:
+    void begin(uint64_t poll_start) { poll_start_ = poll_start; }
+
+    void idle()
+    {
+        prev_start_ = poll_start_;
+        backlog_ = false;
+    }
+
+    // Returns the width of this burst's arrival window, in ticks.
+    uint64_t end(unsigned n, unsigned burst_size, uint64_t poll_end)
+    {
+        hi_ = poll_end;
+        n_ = n;
+        // after a full burst the queue may still hold older packets, so the
+        // window stays open at the earlier bound
+        if (!backlog_) lo_ = prev_start_;
+        backlog_ = n == burst_size;
+        prev_start_ = poll_start_;
+        if (lo_ == 0 || lo_ > hi_) lo_ = poll_start_;
+        return hi_ - lo_;
+    }
+
+    // Packet i of the burst, spread evenly over the window (the last at hi).
+    uint64_t stamp(unsigned i) const { return n_ ? lo_ + (hi_ - lo_) * (i + 1) / n_ : hi_; }
+
+private:
+    uint64_t poll_start_ = 0;
+    uint64_t prev_start_ = 0;
+    uint64_t lo_ = 0;
+    uint64_t hi_ = 0;
+    unsigned n_ = 0;
+    bool backlog_ = false;
+};
@@ -0,0 +1,596 @@
+// Kernel-socket version of dpdk_recv for machines without DPDK: same command
+// line, same feed pipeline (feed_handler.h), built by default.
+//   --mode recvmmsg (default): one UDP socket per line, joined to its group,
+//     drained with non-blocking recvmmsg in batches of --batch datagrams.
+//   --mode packet: one AF_PACKET TPACKET_V3 ring per RX thread on --iface,
+//     classified with the same SIMD UdpFilter as the DPDK receiver.
+// Every datagram carries an SO_TIMESTAMPING stamp (--timestamp sw|hw|off).
+// The distance from that stamp to user space is recorded as the kernel
+// latency, and the message TSC is backdated by it, so wire-to-consumer means
+// the same thing as under DPDK.
+
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "feed_handler.h"
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+static std::atomic<bool> keep_running{true};
+
+static void
+signal_handler(int signum)
+{
+    (void)signum;
+    keep_running.store(false, std::memory_order_relaxed);
+}
+
+enum class RxMode { Recvmmsg, Packet };
+enum class TsMode { Off, Software, Hardware };
+
+struct SockOptions {
+    RxMode mode = RxMode::Recvmmsg;
+    TsMode timestamp = TsMode::Software;
+    std::string iface;       // empty: any interface / default multicast route
+    int ifindex = 0;
+    unsigned batch = 32;     // recvmmsg vlen
+    int busy_poll_us = 0;    // SO_BUSY_POLL, 0 = off
+    int rcvbuf = 0;          // SO_RCVBUF, 0 = system default
+};
+
+static uint64_t realtime_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void set_busy_poll(int fd, int us)
+{
+    if (us <= 0) return;
+    const int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) != 0)
+        std::cerr << "Warning: SO_BUSY_POLL failed: " << std::strerror(errno) << std::endl;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one)) != 0)
+        std::cerr << "Warning: SO_PREFER_BUSY_POLL failed: " << std::strerror(errno) << std::endl;
+}
+
+// Tell the NIC driver to stamp every received packet (SIOCSHWTSTAMP).
+static bool enable_hw_timestamps(const std::string& iface)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return false;
+    struct hwtstamp_config cfg;
+    std::memset(&cfg, 0, sizeof(cfg));
+    cfg.tx_type = HWTSTAMP_TX_OFF;
+    cfg.rx_filter = HWTSTAMP_FILTER_ALL;
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", iface.c_str());
+    ifr.ifr_data = reinterpret_cast<char*>(&cfg);
+    const int rc = ioctl(fd, SIOCSHWTSTAMP, &ifr);
+    close(fd);
+    if (rc != 0) std::cerr << "Warning: SIOCSHWTSTAMP on " << iface << " failed: " << std::strerror(errno) << std::endl;
+    return rc == 0;
+}
+
+static bool join_group(int fd, const FeedLine& l, int ifindex)
+{
+    if ((l.ip & 0xF0000000u) != 0xE0000000u) return true; // unicast target: nothing to join
+    struct ip_mreqn mreq;
+    std::memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr.s_addr = htonl(l.ip);
+    mreq.imr_address.s_addr = htonl(INADDR_ANY);
+    mreq.imr_ifindex = ifindex;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        std::cerr << "Failed to join " << l.name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Non-blocking UDP socket bound to the line's group:port (binding the group
+// address keeps other groups on the same port out), joined and stamped.
+static int open_line_socket(const FeedLine& l, const SockOptions& o)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        std::cerr << "socket() failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    if (o.rcvbuf > 0 && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &o.rcvbuf, sizeof(o.rcvbuf)) != 0)
+        std::cerr << "Warning: SO_RCVBUF failed: " << std::strerror(errno) << std::endl;
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(l.ip);
+    addr.sin_port = htons(l.port);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "bind(" << l.name << ") failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    if (!join_group(fd, l, o.ifindex)) {
+        close(fd);
+        return -1;
+    }
+
+    if (o.timestamp != TsMode::Off) {
+        const int flags = o.timestamp == TsMode::Hardware
+                              ? SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+                              : SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) != 0)
+            std::cerr << "Warning: SO_TIMESTAMPING failed: " << std::strerror(errno) << std::endl;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)); // drop counter in every cmsg
+    set_busy_poll(fd, o.busy_poll_us);
+    return fd;
+}
+
+// One RX thread ("queue"): its sockets or packet ring, the shared feed
+// pipeline and the kernel-to-user latency of the datagrams it read.
+struct SockWorker {
+    SockWorker(unsigned queue, const std::vector<FeedLine>& lines, uint64_t gap_timeout_ns, AsyncLog::Producer& log,
+               FeedConsumer& consumer)
+        : handler(queue, lines, gap_timeout_ns, log, consumer)
+    {
+    }
+
+    FeedHandler handler;
+    std::vector<int> fds;         // recvmmsg: one per line, index = line
+    std::vector<uint32_t> ovfl;   // recvmmsg: last SO_RXQ_OVFL value per socket
+    int packet_fd = -1;           // packet mode
+    uint8_t* ring = nullptr;
+    size_t ring_size = 0;
+    HdrHistogram kernel_latency;  // stamp -> user space, ns
+};
+
+// Backdates rx_tsc by the time since the kernel/NIC stamp. Stamps are
+// CLOCK_REALTIME (software) or the NIC clock, which must be synchronised to
+// the system clock (phc2sys) for hardware stamps to make sense here.
+static uint64_t stamp_to_tsc(SockWorker& w, const TscClock& clk, uint64_t stamp_ns, uint64_t now_ns, uint64_t rx_tsc)
+{
+    if (stamp_ns == 0 || stamp_ns > now_ns) return rx_tsc;
+    const uint64_t delay = now_ns - stamp_ns;
+    w.kernel_latency.record(delay);
+    const uint64_t ticks = clk.from_ns(delay);
+    return ticks < rx_tsc ? rx_tsc - ticks : rx_tsc;
+}
+
+static void recvmmsg_loop(SockWorker& w, const SockOptions& o)
+{
+    FeedHandler& h = w.handler;
+    RxQueueStats& s = h.stats();
+    const TscClock& clk = TscClock::instance();
+    const unsigned batch = o.batch;
+    const size_t kMaxDatagram = 2048;
+    const size_t kControl = CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t)) + 64;
+    std::vector<uint8_t> bufs(batch * kMaxDatagram);
+    std::vector<uint8_t> control(batch * kControl);
+    std::vector<struct iovec> iov(batch);
+    std::vector<struct mmsghdr> msgs(batch);
+    for (unsigned i = 0; i < batch; ++i) {
+        iov[i].iov_base = &bufs[i * kMaxDatagram];
+        iov[i].iov_len = kMaxDatagram;
+        std::memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    const bool hw = o.timestamp == TsMode::Hardware;
+
+    while (keep_running.load(std::memory_order_relaxed)) {
+        for (unsigned line = 0; line < w.fds.size(); ++line) {
+            for (unsigned i = 0; i < batch; ++i) {
+                msgs[i].msg_hdr.msg_control = &control[i * kControl];
+                msgs[i].msg_hdr.msg_controllen = kControl;
+            }
+            const int n = recvmmsg(w.fds[line], msgs.data(), batch, MSG_DONTWAIT, nullptr);
+            if (n <= 0) continue;
+            const uint64_t rx_tsc = clk.now();
+            const uint64_t now_ns = o.timestamp != TsMode::Off ? realtime_ns() : 0;
+            ++s.bursts;
+            for (int i = 0; i < n; ++i) {
+                uint64_t stamp_ns = 0;
+                for (struct cmsghdr* c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c; c = CMSG_NXTHDR(&msgs[i].msg_hdr, c)) {
+                    if (c->cmsg_level != SOL_SOCKET) continue;
+                    if (c->cmsg_type == SCM_TIMESTAMPING) {
+                        struct scm_timestamping ts;
+                        std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                        const struct timespec& t = ts.ts[hw ? 2 : 0];
+                        stamp_ns = (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+                    } else if (c->cmsg_type == SO_RXQ_OVFL) {
+                        std::memcpy(&w.ovfl[line], CMSG_DATA(c), sizeof(uint32_t));
+                    }
+                }
+                h.on_payload(line, static_cast<const uint8_t*>(iov[i].iov_base), msgs[i].msg_len,
+                             stamp_to_tsc(w, clk, stamp_ns, now_ns, rx_tsc));
+            }
+            s.total += (unsigned)n;
+            s.matched += (unsigned)n;
+        }
+        h.poll(clk);
+    }
+}
+
+// TPACKET_V3 geometry: 64 blocks of 1 MiB. The kernel hands a block over when
+// it is full or after kBlockTimeoutMs, which bounds the added latency at low
+// rates.
+static constexpr unsigned kBlockSize = 1u << 20;
+static constexpr unsigned kBlockCount = 64;
+static constexpr unsigned kFrameSize = 2048;
+static constexpr unsigned kBlockTimeoutMs = 1;
+
+static bool open_packet_ring(SockWorker& w, const SockOptions& o, unsigned rx_queues, int fanout_id)
+{
+    int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+    if (fd < 0) {
+        std::cerr << "AF_PACKET socket failed (needs CAP_NET_RAW): " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        std::cerr << "PACKET_VERSION TPACKET_V3 failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    struct tpacket_req3 req;
+    std::memset(&req, 0, sizeof(req));
+    req.tp_block_size = kBlockSize;
+    req.tp_block_nr = kBlockCount;
+    req.tp_frame_size = kFrameSize;
+    req.tp_frame_nr = kBlockSize / kFrameSize * kBlockCount;
+    req.tp_retire_blk_tov = kBlockTimeoutMs;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        std::cerr << "PACKET_RX_RING failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    if (o.timestamp == TsMode::Hardware) {
+        const int req_ts = SOF_TIMESTAMPING_RAW_HARDWARE;
+        if (setsockopt(fd, SOL_PACKET, PACKET_TIMESTAMP, &req_ts, sizeof(req_ts)) != 0)
+            std::cerr << "Warning: PACKET_TIMESTAMP failed: " << std::strerror(errno) << std::endl;
+    }
+    w.ring_size = (size_t)kBlockSize * kBlockCount;
+    void* map = mmap(nullptr, w.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "mmap of the packet ring failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    struct sockaddr_ll sll;
+    std::memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex = o.ifindex;
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&sll), sizeof(sll)) != 0) {
+        std::cerr << "bind to " << (o.iface.empty() ? "all interfaces" : o.iface) << " failed: " << std::strerror(errno)
+                  << std::endl;
+        munmap(map, w.ring_size);
+        close(fd);
+        return false;
+    }
+    if (rx_queues > 1) {
+        // spread flows over the RX threads by the kernel's flow hash, like RSS
+        const int fanout = fanout_id | (PACKET_FANOUT_HASH << 16);
+        if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) != 0) {
+            std::cerr << "PACKET_FANOUT failed: " << std::strerror(errno) << std::endl;
+            munmap(map, w.ring_size);
+            close(fd);
+            return false;
+        }
+    }
+    set_busy_poll(fd, o.busy_poll_us);
+    w.packet_fd = fd;
+    w.ring = static_cast<uint8_t*>(map);
+    return true;
+}
+
+static void packet_loop(SockWorker& w, const SockOptions& o)
+{
+    FeedHandler& h = w.handler;
+    RxQueueStats& s = h.stats();
+    const TscClock& clk = TscClock::instance();
+    const unsigned BURST_SIZE = UdpFilter::kMaxBurst;
+    const uint8_t* data[BURST_SIZE];
+    uint16_t lens[BURST_SIZE];
+    uint64_t stamps[BURST_SIZE];
+    uint8_t line_of[BURST_SIZE];
+    unsigned block = 0;
+
+    auto flush = [&](unsigned n, uint64_t rx_tsc, uint64_t now_ns) {
+        const uint32_t mask = h.classify(data, lens, n, line_of);
+        for (uint32_t m = mask; m; m &= m - 1) {
+            const unsigned i = (unsigned)__builtin_ctz(m);
+            h.on_frame(line_of[i], data[i], lens[i], stamp_to_tsc(w, clk, stamps[i], now_ns, rx_tsc));
+        }
+        s.matched += (unsigned)__builtin_popcount(mask);
+        s.total += n;
+    };
+
+    while (keep_running.load(std::memory_order_relaxed)) {
+        auto* bd = reinterpret_cast<struct tpacket_block_desc*>(w.ring + (size_t)block * kBlockSize);
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            h.poll(clk);
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        const uint64_t rx_tsc = clk.now();
+        const uint64_t now_ns = o.timestamp != TsMode::Off ? realtime_ns() : 0;
+        ++s.bursts;
+        const unsigned npkts = bd->hdr.bh1.num_pkts;
+        auto* p = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(bd) + bd->hdr.bh1.offset_to_first_pkt);
+        unsigned n = 0;
+        for (unsigned k = 0; k < npkts; ++k) {
+            const auto* sll = reinterpret_cast<const struct sockaddr_ll*>(reinterpret_cast<uint8_t*>(p) +
+                                                                          TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+            // our own transmissions (loopback tests) show up as outgoing too
+            if (sll->sll_pkttype != PACKET_OUTGOING) {
+                data[n] = reinterpret_cast<const uint8_t*>(p) + p->tp_mac;
+                lens[n] = (uint16_t)std::min<uint32_t>(p->tp_snaplen, UINT16_MAX);
+                stamps[n] = o.timestamp != TsMode::Off ? (uint64_t)p->tp_sec * 1000000000ull + p->tp_nsec : 0;
+                if (++n == BURST_SIZE) {
+                    flush(n, rx_tsc, now_ns);
+                    n = 0;
+                }
+            }
+            p = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(p) + p->tp_next_offset);
+        }
+        if (n) flush(n, rx_tsc, now_ns);
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        block = (block + 1) % kBlockCount;
+        h.poll(clk);
+    }
+}
+
+static void pin_this_thread(int cpu)
+{
+    if (cpu < 0) return;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) std::cerr << "Warning: pthread_setaffinity_np failed for cpu " << cpu << " (rc=" << rc << ")\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string target_ip_str = "224.0.0.100";
+    uint32_t target_ip = parse_ipv4_addr("224.0.0.100");
+    uint16_t target_port = 40000;
+    uint16_t rx_queues = 1;
+    int rx_cpu = -1;       // queue q's RX thread runs on rx_cpu + q
+    int log_cpu = -1;      // housekeeping core for the log writer thread
+    int consumer_cpu = -1; // queue q's consumer thread runs on consumer_cpu + q
+    std::vector<FeedLine> extra_lines; // --line: B, C, ... (A is --target-ip/--target-port)
+    uint64_t gap_timeout_us = 100;
+    SockOptions so;
+
+    enum {
+        OPT_LOG_CPU = 256,
+        OPT_CONSUMER_CPU,
+        OPT_LINE,
+        OPT_GAP_TIMEOUT,
+        OPT_IFACE,
+        OPT_MODE,
+        OPT_BATCH,
+        OPT_TIMESTAMP,
+        OPT_BUSY_POLL,
+        OPT_RCVBUF,
+        OPT_RX_CPU
+    };
+    const struct option longopts[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"target-ip", required_argument, nullptr, 'i'},
+        {"target-port", required_argument, nullptr, 't'},
+        {"no-promisc", no_argument, nullptr, 'n'},
+        {"all-multicast", no_argument, nullptr, 'a'},
+        {"rx-queues", required_argument, nullptr, 'q'},
+        {"log-cpu", required_argument, nullptr, OPT_LOG_CPU},
+        {"consumer-cpu", required_argument, nullptr, OPT_CONSUMER_CPU},
+        {"line", required_argument, nullptr, OPT_LINE},
+        {"gap-timeout-us", required_argument, nullptr, OPT_GAP_TIMEOUT},
+        {"iface", required_argument, nullptr, OPT_IFACE},
+        {"mode", required_argument, nullptr, OPT_MODE},           // recvmmsg, packet
+        {"batch", required_argument, nullptr, OPT_BATCH},
+        {"timestamp", required_argument, nullptr, OPT_TIMESTAMP}, // sw, hw, off
+        {"busy-poll", required_argument, nullptr, OPT_BUSY_POLL},
+        {"rcvbuf", required_argument, nullptr, OPT_RCVBUF},
+        {"rx-cpu", required_argument, nullptr, OPT_RX_CPU},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:i:t:naq:", longopts, nullptr)) != -1) {
+        switch (opt) {
+            case 'p': std::cerr << "Note: -p/--port selects a DPDK port and is ignored here (use --iface)" << std::endl; break;
+            case 'i': target_ip_str = optarg; target_ip = parse_ipv4_addr(optarg); break;
+            case 't': target_port = (uint16_t)atoi(optarg); break;
+            case 'n': break; // the kernel filters by group membership; kept for command-line compatibility
+            case 'a': break;
+            case 'q': rx_queues = (uint16_t)std::max(1, atoi(optarg)); break;
+            case OPT_LOG_CPU: log_cpu = atoi(optarg); break;
+            case OPT_CONSUMER_CPU: consumer_cpu = atoi(optarg); break;
+            case OPT_LINE: {
+                FeedLine l;
+                if (!parse_line(optarg, l)) {
+                    std::cerr << "Bad --line '" << optarg << "' (expected IP:PORT)" << std::endl;
+                    return 1;
+                }
+                extra_lines.push_back(l);
+                break;
+            }
+            case OPT_GAP_TIMEOUT: gap_timeout_us = std::strtoull(optarg, nullptr, 10); break;
+            case OPT_IFACE: so.iface = optarg; break;
+            case OPT_MODE:
+                if (std::strcmp(optarg, "recvmmsg") == 0) so.mode = RxMode::Recvmmsg;
+                else if (std::strcmp(optarg, "packet") == 0) so.mode = RxMode::Packet;
+                else {
+                    std::cerr << "Unknown mode '" << optarg << "' (expected recvmmsg or packet)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_BATCH: so.batch = (unsigned)std::clamp(atoi(optarg), 1, 1024); break;
+            case OPT_TIMESTAMP:
+                if (std::strcmp(optarg, "sw") == 0) so.timestamp = TsMode::Software;
+                else if (std::strcmp(optarg, "hw") == 0) so.timestamp = TsMode::Hardware;
+                else if (std::strcmp(optarg, "off") == 0) so.timestamp = TsMode::Off;
+                else {
+                    std::cerr << "Unknown timestamp mode '" << optarg << "' (expected sw, hw or off)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_BUSY_POLL: so.busy_poll_us = atoi(optarg); break;
+            case OPT_RCVBUF: so.rcvbuf = atoi(optarg); break;
+            case OPT_RX_CPU: rx_cpu = atoi(optarg); break;
+            default: break;
+        }
+    }
+
+    std::vector<FeedLine> lines{FeedLine{target_ip, target_port, target_ip_str + ":" + std::to_string(target_port)}};
+    lines.insert(lines.end(), extra_lines.begin(), extra_lines.end());
+    if (lines.size() > FeedArbiter::kMaxLines) {
+        std::cerr << "At most " << FeedArbiter::kMaxLines << " lines are supported" << std::endl;
+        return 1;
+    }
+    if (lines.size() > 1 && rx_queues > 1) {
+        std::cerr << "--line needs --rx-queues 1: all lines are arbitrated on one thread" << std::endl;
+        return 1;
+    }
+    if (so.mode == RxMode::Recvmmsg && rx_queues > 1) {
+        // every socket joined to a group gets its own copy of each datagram
+        std::cerr << "--rx-queues > 1 needs --mode packet (PACKET_FANOUT spreads flows over the threads)" << std::endl;
+        return 1;
+    }
+    if (!so.iface.empty()) {
+        so.ifindex = (int)if_nametoindex(so.iface.c_str());
+        if (so.ifindex == 0) {
+            std::cerr << "Unknown interface " << so.iface << std::endl;
+            return 1;
+        }
+    }
+    if (so.timestamp == TsMode::Hardware) {
+        if (so.iface.empty()) {
+            std::cerr << "--timestamp hw needs --iface" << std::endl;
+            return 1;
+        }
+        enable_hw_timestamps(so.iface);
+    }
+
+    AsyncLog log(stdout, log_cpu);
+    std::vector<std::unique_ptr<FeedConsumer>> consumers;
+    std::vector<std::unique_ptr<SockWorker>> workers;
+    std::vector<int> join_fds; // packet mode: group membership only
+    bool ok = true;
+    for (uint16_t q = 0; q < rx_queues && ok; ++q) {
+        consumers.emplace_back(new FeedConsumer(consumer_cpu < 0 ? -1 : consumer_cpu + q));
+        workers.emplace_back(new SockWorker(q, lines, gap_timeout_us * 1000, log.producer(), *consumers[q]));
+        SockWorker& w = *workers.back();
+        if (so.mode == RxMode::Recvmmsg) {
+            for (const FeedLine& l : lines) {
+                const int fd = open_line_socket(l, so);
+                if (fd < 0) ok = false;
+                w.fds.push_back(fd);
+                w.ovfl.push_back(0);
+            }
+        } else {
+            ok = open_packet_ring(w, so, rx_queues, (int)(getpid() & 0xffff));
+        }
+    }
+    if (ok && so.mode == RxMode::Packet) {
+        // the NIC and the switch only deliver groups somebody has joined
+        for (const FeedLine& l : lines) {
+            const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            if (fd < 0 || !join_group(fd, l, so.ifindex)) ok = false;
+            join_fds.push_back(fd);
+        }
+    }
+    if (!ok) return 1;
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    std::cout << "Socket receiver (" << (so.mode == RxMode::Packet ? "AF_PACKET TPACKET_V3" : "recvmmsg") << ", "
+              << (so.iface.empty() ? std::string("any interface") : so.iface) << ") listening for IPv4 UDP dst";
+    for (size_t i = 0; i < lines.size(); ++i) std::cout << " " << (char)('A' + i) << "=" << lines[i].name;
+    std::cout << std::endl;
+
+    log.start();
+    for (auto& c : consumers) c->start();
+    std::vector<std::thread> threads;
+    for (uint16_t q = 0; q < rx_queues; ++q) {
+        threads.emplace_back([&, q] {
+            pin_this_thread(rx_cpu < 0 ? -1 : rx_cpu + q);
+            if (so.mode == RxMode::Packet) packet_loop(*workers[q], so);
+            else recvmmsg_loop(*workers[q], so);
+        });
+    }
+    while (keep_running.load(std::memory_order_relaxed)) usleep(100000);
+    for (auto& t : threads) t.join();
+    for (auto& c : consumers) c->stop();
+    log.stop();
+
+    HdrHistogram kernel_latency;
+    uint64_t kernel_drops = 0;
+    for (auto& w : workers) {
+        for (size_t i = 0; i < w->fds.size(); ++i) {
+            kernel_drops += w->ovfl[i];
+            close(w->fds[i]);
+        }
+        if (w->packet_fd >= 0) {
+            struct tpacket_stats_v3 st;
+            socklen_t len = sizeof(st);
+            if (getsockopt(w->packet_fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) kernel_drops += st.tp_drops;
+            munmap(w->ring, w->ring_size);
+            close(w->packet_fd);
+        }
+        kernel_latency.merge(w->kernel_latency);
+    }
+    for (const int fd : join_fds) close(fd);
+
+    std::cout << "Kernel drops (" << (so.mode == RxMode::Packet ? "PACKET_STATISTICS" : "SO_RXQ_OVFL")
+              << "): " << kernel_drops << std::endl;
+    std::vector<const FeedHandler*> handlers;
+    for (const auto& w : workers) handlers.push_back(&w->handler);
+    print_feed_summary(handlers, lines);
+    if (kernel_latency.count() > 0) {
+        std::cout << "Kernel-to-user latency (" << (so.timestamp == TsMode::Hardware ? "hw" : "sw") << " stamp, "
+                  << kernel_latency.count() << " pkts): p50=" << kernel_latency.percentile(50)
+                  << "ns p99=" << kernel_latency.percentile(99) << "ns max=" << kernel_latency.max() << "ns"
+                  << std::endl;
+    }
+    if (log.dropped()) std::cout << "Log records dropped (ring full): " << log.dropped() << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <arpa/inet.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Burst classifier for Ethernet/IPv4/UDP frames addressed to one group:port.
+// No DPDK types, so the socket receiver can share it with the DPDK ones.
+// - Pass 1 gathers ethertype+proto, dst IP and dst port of every frame into
+//   three arrays (memcpy loads: no unaligned pointer casts, no byte swaps;
+//   keys stay in network order and are compared against pre-swapped targets).
+//   Frames too short for the headers get keys that cannot match.
+// - Pass 2 compares four frames at a time with SSE2 and returns one bit per
+//   frame (bit i set = frame i matched).
+// Callers prefetch frame data a few packets ahead before classify().
+class UdpFilter {
+public:
+    static constexpr unsigned kMaxBurst = 32;
+
+    // ip and port in host order, as parsed from the command line
+    UdpFilter(uint32_t dst_ip, uint16_t dst_port)
+    {
+        const uint8_t ipv4_udp[4] = {0x08, 0x00, 17, 0}; // ethertype 0x0800, proto UDP
+        std::memcpy(&k0_, ipv4_udp, 4);
+        k1_ = htonl(dst_ip);
+        k2_ = htons(dst_port);
+    }
+
+    // Bit mask of the frames in pkts[0..n) (n <= kMaxBurst) that match.
+    uint32_t classify(const uint8_t* const* pkts, const uint16_t* lens, unsigned n) const
+    {
+        alignas(16) uint32_t k0[kMaxBurst], k1[kMaxBurst], k2[kMaxBurst];
+        for (unsigned i = 0; i < n; ++i) gather(pkts[i], lens[i], k0[i], k1[i], k2[i]);
+        // pad the last group of four with keys that never match
+        for (unsigned i = n; i < ((n + 3) & ~3u); ++i) k0[i] = ~k0_, k1[i] = 0, k2[i] = 0;
+
+        uint32_t mask = 0;
+#if defined(__SSE2__)
+        const __m128i t0 = _mm_set1_epi32((int)k0_), t1 = _mm_set1_epi32((int)k1_), t2 = _mm_set1_epi32((int)k2_);
+        for (unsigned i = 0; i < n; i += 4) {
+            __m128i eq = _mm_and_si128(
+                _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(k0 + i)), t0),
+                _mm_and_si128(_mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(k1 + i)), t1),
+                              _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(k2 + i)), t2)));
+            mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(eq)) << i;
+        }
+#else
+        for (unsigned i = 0; i < n; ++i)
+            mask |= (uint32_t)(k0[i] == k0_ && k1[i] == k1_ && k2[i] == k2_) << i;
+#endif
+        return n < 32 ? mask & ((1u << n) - 1) : mask;
+    }
+
+    // Scalar check of one frame (same rules as classify()).
+    bool match(const uint8_t* pkt, uint16_t len) const
+    {
+        uint32_t a, b, c;
+        gather(pkt, len, a, b, c);
+        return a == k0_ && b == k1_ && c == k2_;
+    }
+
+    // Offset of the UDP payload in a frame that matched.
+    static unsigned payload_offset(const uint8_t* pkt) { return 14u + (pkt[14] & 0x0fu) * 4u + 8u; }
+
+private:
+    static void gather(const uint8_t* p, uint16_t len, uint32_t& k0, uint32_t& k1, uint32_t& k2)
+    {
+        // Ethernet(14) + IPv4(20) + UDP(8)
+        if (len < 14 + 20 + 8) {
+            k0 = 0, k1 = 0, k2 = UINT32_MAX;
+            return;
+        }
+        uint16_t ethertype;
+        std::memcpy(&ethertype, p + 12, 2);
+        k0 = 0;
+        std::memcpy(&k0, &ethertype, 2);
+        reinterpret_cast<uint8_t*>(&k0)[2] = p[14 + 9]; // IPv4 protocol
+        std::memcpy(&k1, p + 14 + 16, 4);              // IPv4 destination
+        const unsigned ihl = (p[14] & 0x0fu) * 4u;
+        if (ihl < 20 || 14u + ihl + 8u > len) {
+            k2 = UINT32_MAX;
+            return;
+        }
+        uint16_t port;
+        std::memcpy(&port, p + 14 + ihl + 2, 2);       // UDP destination port
+        k2 = port;
+    }
+
+    uint32_t k0_ = 0; // ethertype | proto << 16, as laid out in memory
+    uint32_t k1_ = 0; // network-order destination address
+    uint32_t k2_ = 0; // network-order destination port
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Log-linear (HDR-style) latency histogram with constant memory and O(1) record.
+// - Values below 2^SubBucketBits are counted exactly.
+// - Every power-of-two range above that is split into 2^(SubBucketBits-1)
+//   linear sub-buckets, so the relative error is bounded by 2^-(SubBucketBits-1)
+//   (0.8% for the default of 8) across the whole uint64_t range.
+// - Counters are plain integers: a histogram is owned by one thread and
+//   merged into an aggregate afterwards (merge() is cheap: one add per bucket).
+// Units are up to the caller; the benchmarks record nanoseconds.
+template<unsigned SubBucketBits = 8>
+class BasicHdrHistogram {
+    static_assert(SubBucketBits >= 2 && SubBucketBits < 32, "unsupported precision");
+
+public:
+    static constexpr uint64_t kLinear = uint64_t(1) << SubBucketBits;       // exact range
+    static constexpr uint64_t kSubBuckets = kLinear / 2;                    // per power of two
+    static constexpr size_t kBuckets = kLinear + (64 - SubBucketBits) * kSubBuckets;
+
+    BasicHdrHistogram() : counts_(kBuckets, 0) {}
+
+    void record(uint64_t v) noexcept { record_n(v, 1); }
+
+    void record_n(uint64_t v, uint64_t n) noexcept
+    {
+        counts_[index_of(v)] += n;
+        count_ += n;
+        sum_ += (double)v * (double)n;
+        if (v < min_) min_ = v;
+        if (v > max_) max_ = v;
+    }
+
+    // Coordinated-omission back-fill for closed-loop callers that issue one op
+    // every `expected_interval`: a sample of v > interval also stands for the
+    // ops that would have been sent while it stalled, recorded as
+    // v - interval, v - 2*interval, ... down to interval (HdrHistogram's
+    // recordValueWithExpectedInterval). Open-loop callers that measure from
+    // the intended start already see those delays and should use record().
+    void record_corrected(uint64_t v, uint64_t expected_interval) noexcept
+    {
+        record(v);
+        if (expected_interval == 0) return;
+        for (uint64_t missing = v >= expected_interval ? v - expected_interval : 0; missing >= expected_interval;
+             missing -= expected_interval)
+            record(missing);
+    }
+
+    void merge(const BasicHdrHistogram& o) noexcept
+    {
+        for (size_t i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+        count_ += o.count_;
+        sum_ += o.sum_;
+        min_ = std::min(min_, o.min_);
+        max_ = std::max(max_, o.max_);
+    }
+
+    void reset() noexcept
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        count_ = 0; sum_ = 0.0; min_ = UINT64_MAX; max_ = 0;
+    }
+
+    uint64_t count() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    uint64_t min() const noexcept { return count_ ? min_ : 0; }
+    uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return count_ ? sum_ / (double)count_ : 0.0; }
+
+    // Smallest recorded-equivalent value v such that p% of samples are <= v.
+    // Reports the top of the matching bucket (clamped to the exact max), as
+    // HdrHistogram does, so tails are never under-reported.
+    uint64_t percentile(double p) const noexcept
+    {
+        if (count_ == 0) return 0;
+        if (p <= 0.0) return min();
+        if (p >= 100.0) return max_;
+        uint64_t target = (uint64_t)((p / 100.0) * (double)count_ + 0.5);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    // Visit non-empty buckets in value order: fn(lowest, highest, count).
+    template<typename Fn>
+    void for_each_bucket(Fn&& fn) const
+    {
+        for (size_t i = 0; i < kBuckets; ++i)
+            if (counts_[i]) fn(lowest_equivalent(i), highest_equivalent(i), counts_[i]);
+    }
+
+    // Text serialization: a header line followed by sparse "index count"
+    // pairs. Stable across runs so histograms can be stored and merged later.
+    void serialize(std::ostream& os) const
+    {
+        auto prec = os.precision(17);
+        os << "hdrhist 1 " << SubBucketBits << ' ' << count_ << ' ' << min() << ' ' << max_ << ' ' << sum_ << '\n';
+        for (size_t i = 0; i < kBuckets; ++i)
+            if (counts_[i]) os << i << ' ' << counts_[i] << '\n';
+        os << "end\n";
+        os.precision(prec);
+    }
+
+    bool deserialize(std::istream& is)
+    {
+        std::string magic;
+        unsigned version = 0, bits = 0;
+        uint64_t count = 0, minv = 0, maxv = 0;
+        double sum = 0.0;
+        if (!(is >> magic >> version >> bits >> count >> minv >> maxv >> sum)) return false;
+        if (magic != "hdrhist" || version != 1 || bits != SubBucketBits) return false;
+        reset();
+        std::string tok;
+        while (is >> tok && tok != "end") {
+            uint64_t n = 0;
+            char* end = nullptr;
+            size_t idx = std::strtoull(tok.c_str(), &end, 10);
+            if (*end != '\0' || !(is >> n) || idx >= kBuckets) return false;
+            counts_[idx] = n;
+        }
+        count_ = count; sum_ = sum; max_ = maxv; min_ = count ? minv : UINT64_MAX;
+        return true;
+    }
+
+    static size_t index_of(uint64_t v) noexcept
+    {
+        if (v < kLinear) return (size_t)v;
+        unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+        unsigned shift = msb - (SubBucketBits - 1);
+        uint64_t sub = (v >> shift) & (kSubBuckets - 1);
+        return (size_t)(kLinear + (uint64_t)(msb - SubBucketBits) * kSubBuckets + sub);
+    }
+
+    static uint64_t lowest_equivalent(size_t idx) noexcept
+    {
+        if (idx < kLinear) return idx;
+        uint64_t k = idx - kLinear;
+        unsigned msb = SubBucketBits + (unsigned)(k / kSubBuckets);
+        uint64_t sub = k % kSubBuckets;
+        return (kSubBuckets + sub) << (msb - (SubBucketBits - 1));
+    }
+
+    static uint64_t highest_equivalent(size_t idx) noexcept
+    {
+        if (idx < kLinear) return idx;
+        unsigned msb = SubBucketBits + (unsigned)((idx - kLinear) / kSubBuckets);
+        return lowest_equivalent(idx) + ((uint64_t(1) << (msb - (SubBucketBits - 1))) - 1);
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+using HdrHistogram = BasicHdrHistogram<>;
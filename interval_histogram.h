@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "hdr_histogram.h"
+
+// Per-interval latency snapshots from a polling loop without locks.
+// - The writer (one polling thread) records into one of two histograms and,
+//   once per period, hands it to the reader by publishing its index with a
+//   release store, then continues in the other one. The writer never waits:
+//   if the reader has not returned the previous snapshot yet, the current
+//   interval simply runs on until the next poll that finds the slot free.
+// - The reader (a housekeeping thread) takes the published histogram,
+//   prints or merges it, and release()s it, which resets it for reuse.
+// - At shutdown, with the writer stopped, drain_into() collects whatever
+//   was not published, so interval snapshots add up to the whole session.
+// Times are TscClock ticks; a period of 0 never publishes.
+class IntervalHistogram {
+public:
+    struct Snapshot {
+        const HdrHistogram* hist; // nullptr if nothing was published
+        uint64_t start_tsc;
+        uint64_t end_tsc;
+    };
+
+    IntervalHistogram(uint64_t period_ticks, uint64_t now) : period_(period_ticks), start_(now), next_(now + period_ticks) {}
+
+    // Writer side.
+    void record(uint64_t v) noexcept { bufs_[active_].record(v); }
+
+    void tick(uint64_t now) noexcept
+    {
+        if (period_ == 0 || now < next_ || published_.load(std::memory_order_acquire) != kNone) return;
+        start_tsc_[active_] = start_;
+        end_tsc_[active_] = now;
+        published_.store(active_, std::memory_order_release);
+        active_ ^= 1;
+        start_ = now;
+        next_ = now + period_;
+    }
+
+    // Reader side.
+    Snapshot take() const noexcept
+    {
+        const unsigned i = published_.load(std::memory_order_acquire);
+        if (i == kNone) return Snapshot{nullptr, 0, 0};
+        return Snapshot{&bufs_[i], start_tsc_[i], end_tsc_[i]};
+    }
+
+    void release() noexcept
+    {
+        const unsigned i = published_.load(std::memory_order_relaxed);
+        if (i == kNone) return;
+        bufs_[i].reset();
+        published_.store(kNone, std::memory_order_release);
+    }
+
+    // Both threads quiet: everything not yet released.
+    void drain_into(HdrHistogram& total) noexcept
+    {
+        for (HdrHistogram& h : bufs_) {
+            total.merge(h);
+            h.reset();
+        }
+        published_.store(kNone, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr unsigned kNone = 2;
+
+    // writer-owned
+    uint64_t period_;
+    uint64_t start_;
+    uint64_t next_;
+    unsigned active_ = 0;
+    // handed over with published_
+    HdrHistogram bufs_[2];
+    uint64_t start_tsc_[2] = {0, 0};
+    uint64_t end_tsc_[2] = {0, 0};
+    alignas(64) std::atomic<unsigned> published_{kNone};
+};
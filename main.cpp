@@ -14,6 +14,23 @@
 #include <string>
 #include <sys/stat.h>
 #include <cstdio>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <sched.h>
+#include "access_pattern.h"
+#include "bench_report.h"
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+#include "open_loop.h"
+#include "uring.h"
 
 // Helper function to align memory
 void* aligned_malloc(size_t size, size_t align) {
@@ -28,194 +45,1090 @@ void aligned_free(void* ptr) {
     free(ptr);
 }
 
+// How writes are made durable.
+// - none:      plain write, page cache / device cache only
+// - odsync:    files opened with O_DSYNC, every write waits for stable storage
+// - fdatasync: plain writes plus fdatasync() every sync_every writes
+// - rwf-dsync: per-write RWF_DSYNC (pwritev2 / io_uring rw_flags)
+// - group:     all writers share one file; one fdatasync covers every write
+//              completed before it started (leader/follower group commit)
+enum class Durability { None, ODsync, Fdatasync, RwfDsync, Group };
+
+static bool parse_durability(const std::string& s, Durability& out) {
+    if (s == "none") out = Durability::None;
+    else if (s == "odsync") out = Durability::ODsync;
+    else if (s == "fdatasync") out = Durability::Fdatasync;
+    else if (s == "rwf-dsync") out = Durability::RwfDsync;
+    else if (s == "group") out = Durability::Group;
+    else return false;
+    return true;
+}
+
+static const char* durability_name(Durability d) {
+    switch (d) {
+        case Durability::None: return "none";
+        case Durability::ODsync: return "odsync";
+        case Durability::Fdatasync: return "fdatasync";
+        case Durability::RwfDsync: return "rwf-dsync";
+        case Durability::Group: return "group";
+    }
+    return "?";
+}
+
+struct BenchOptions {
+    size_t buffer_size = 4096; // bytes
+    size_t alignment = 4096;
+    int num_tests = 10000;
+    std::string engine = "sync"; // sync | uring | mmap
+    unsigned iodepth = 1;
+    bool fixed_bufs = true;      // uring: IORING_REGISTER_BUFFERS + READ/WRITE_FIXED
+    bool fixed_files = true;     // uring: IORING_REGISTER_FILES + IOSQE_FIXED_FILE
+    int jobs = 1;                // parallel benchmark threads, one fd each
+    std::vector<int> cpus;       // optional pinning: job j runs on cpus[j % cpus.size()]
+    bool shared_file = false;    // writes: all jobs share one file, each in its own region
+    uint64_t seed = 1;           // --seed: base of every job's op-stream RNG (fixed for repeatable runs)
+    Pattern read_pattern = Pattern::Random;
+    Pattern write_pattern = Pattern::Random;
+    uint64_t stride_bytes = 64 * 1024; // --pattern stride step
+    double zipf_theta = 0.99;
+    int read_pct = 50;                 // --mode mixed: share of ops that are reads
+    Durability durability = Durability::None;
+    int sync_every = 1;                // --durability fdatasync: writes per fdatasync
+    unsigned group_delay_us = 0;       // --durability group: leader waits this long to grow the batch
+    bool map_populate = false;         // mmap: MAP_POPULATE the region up front
+    int map_advice = -1;               // mmap: madvise() advice for the region, -1 = none
+    bool map_msync = false;            // mmap: msync(MS_SYNC) each written range
+    double rate = 0.0;                 // --rate: open loop at this many ops/s over all jobs, 0 = closed loop
+    uint64_t expected_interval_ns = 0; // closed loop: coordinated-omission back-fill interval, 0 = off
+};
+
+// Offset space of one job: blocks [base_block, base_block + max_blocks).
+// Sequential/strided streams start start_block into the space.
+struct JobSpace {
+    off_t base_block = 0;
+    off_t max_blocks = 1;
+    uint64_t seed = 0;
+    uint64_t start_block = 0;
+    int job = 0;
+};
+
+// Per-direction latency histograms (ns) plus what is needed for IOPS / bandwidth.
+struct IoResult {
+    HdrHistogram read_ns;
+    HdrHistogram write_ns;
+    uint64_t ops = 0;
+    uint64_t bytes = 0;
+    uint64_t syncs = 0;          // fdatasync calls issued by this job
+    uint64_t major_faults = 0;   // mmap: page faults during the timed loop (getrusage)
+    uint64_t minor_faults = 0;
+    double setup_s = 0.0;        // mmap: mmap + madvise (+ populate) time
+    uint64_t late_ops = 0;       // --rate: ops issued an interval or more behind schedule
+    uint64_t max_lag_ns = 0;     // --rate: worst schedule lag of the generator itself
+    double elapsed_s = 0.0;
+    // the timed loop only (no engine setup or teardown); multi-job runs
+    // aggregate from the earliest start to the latest end
+    std::chrono::steady_clock::time_point loop_start{}, loop_end{};
+
+    HdrHistogram& hist(bool is_write) { return is_write ? write_ns : read_ns; }
+};
+
+// --rate splits the target evenly between jobs, each offset by a fraction of
+// an interval so they do not all fire at once. Disabled (closed loop) without it.
+static OpenLoopSchedule job_schedule(const BenchOptions& o, const JobSpace& js) {
+    if (o.rate <= 0.0) return OpenLoopSchedule();
+    return OpenLoopSchedule(TscClock::instance(), o.rate / o.jobs, (double)js.job / o.jobs);
+}
+
+static void finish_schedule(IoResult& r, const OpenLoopSchedule& sched) {
+    r.late_ops = sched.late_ops();
+    r.max_lag_ns = sched.max_lag_ns();
+}
+
+// Per-job op stream: picks the direction of each IO (read_pct% reads) and
+// its offset from the read or write access pattern.
+class OpStream {
+public:
+    OpStream(const BenchOptions& o, const JobSpace& js, int read_pct)
+        : rng_(js.seed), read_pct_(read_pct), base_(js.base_block), align_(o.alignment),
+          reads_(o.read_pattern, (uint64_t)js.max_blocks, o.stride_bytes / o.alignment, o.zipf_theta, js.start_block),
+          writes_(o.write_pattern, (uint64_t)js.max_blocks, o.stride_bytes / o.alignment, o.zipf_theta, js.start_block)
+    {}
+
+    // Returns true for a write; stores the byte offset of the IO.
+    bool next(off_t& offset)
+    {
+        bool is_write = read_pct_ <= 0 || (read_pct_ < 100 && (int)rng_.below(100) >= read_pct_);
+        offset = (base_ + (off_t)(is_write ? writes_ : reads_).next(rng_)) * (off_t)align_;
+        return is_write;
+    }
+
+private:
+    FastRng rng_;
+    int read_pct_;
+    off_t base_;
+    size_t align_;
+    AccessPattern reads_;
+    AccessPattern writes_;
+};
+
+// Leader/follower group commit over one file. A writer whose write has
+// completed takes a ticket; if no sync is running it becomes the leader and
+// runs one fdatasync covering every ticket handed out so far, otherwise it
+// waits for a leader whose sync covers its ticket.
+// A failed fdatasync fails every ticket it covered, not only the leader's.
+// Those tickets are never retried: after a writeback error the kernel may
+// drop the dirty pages and report the next fdatasync as clean.
+class GroupCommit {
+public:
+    explicit GroupCommit(unsigned delay_us) : delay_us_(delay_us) {}
+
+    // Blocks until the sync covering the caller's completed write has
+    // finished. Returns true if this call ran the fdatasync, false otherwise;
+    // err is 0 if the write is durable, else -errno of the sync that covered it.
+    bool commit(int fd, int& err) {
+        std::unique_lock<std::mutex> lk(m_);
+        const uint64_t ticket = ++completed_;
+        bool led = false;
+        err = 0;
+        while (resolved_ < ticket) {
+            if (syncing_) { cv_.wait(lk); continue; }
+            syncing_ = true;
+            lk.unlock();
+            if (delay_us_) std::this_thread::sleep_for(std::chrono::microseconds(delay_us_));
+            lk.lock();
+            const uint64_t target = completed_;
+            lk.unlock();
+            int rc = fdatasync(fd);
+            int e = rc != 0 ? errno : 0;
+            lk.lock();
+            syncing_ = false;
+            if (e) failed_.push_back(Failure{resolved_ + 1, target, e, target - resolved_});
+            resolved_ = target;
+            led = true;
+            cv_.notify_all();
+        }
+        for (size_t i = 0; i < failed_.size(); ++i) {
+            Failure& f = failed_[i];
+            if (ticket < f.first || ticket > f.last) continue;
+            err = -f.err;
+            if (--f.waiting == 0) failed_.erase(failed_.begin() + (ptrdiff_t)i);
+            break;
+        }
+        return led;
+    }
+
+private:
+    // Tickets [first, last] were covered by a failed fdatasync; dropped once
+    // all of their writers have picked up the error.
+    struct Failure {
+        uint64_t first;
+        uint64_t last;
+        int err;
+        uint64_t waiting;
+    };
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    uint64_t completed_ = 0; // writes that have returned from pwrite
+    uint64_t resolved_ = 0;  // highest ticket covered by a finished fdatasync, failed or not
+    std::vector<Failure> failed_;
+    bool syncing_ = false;
+    unsigned delay_us_;
+};
+
+// One IO at a time: lseek+read for reads (as before), pwrite for writes.
+// Write latency includes whatever the durability mode adds (the periodic
+// fdatasync, RWF_DSYNC, or waiting for the group commit). With --rate each IO
+// waits for its scheduled time and latency counts from that time.
+static IoResult run_sync(int fd, int read_pct, const BenchOptions& o, void* buffer, const JobSpace& js,
+                         GroupCommit* group) {
+    IoResult r;
+    OpStream ops(o, js, read_pct);
+    int writes_since_sync = 0;
+    const TscClock& clk = TscClock::instance();
+    r.loop_start = std::chrono::steady_clock::now();
+    OpenLoopSchedule sched = job_schedule(o, js);
+    for (int i = 0; i < o.num_tests; ++i) {
+        const uint64_t due = sched.enabled() ? sched.wait((uint64_t)i) : 0;
+        off_t offset;
+        bool is_write = ops.next(offset);
+        ssize_t n;
+        uint64_t start, end;
+        if (is_write) {
+            start = clk.start();
+            if (o.durability == Durability::RwfDsync) {
+                iovec iov{buffer, o.buffer_size};
+                n = pwritev2(fd, &iov, 1, offset, RWF_DSYNC);
+            } else {
+                n = pwrite(fd, buffer, o.buffer_size, offset);
+            }
+            if (n == (ssize_t)o.buffer_size) {
+                int err = 0;
+                if (o.durability == Durability::Fdatasync && ++writes_since_sync >= o.sync_every) {
+                    writes_since_sync = 0;
+                    ++r.syncs;
+                    if (fdatasync(fd) != 0) err = -errno;
+                } else if (o.durability == Durability::Group && group) {
+                    if (group->commit(fd, err)) ++r.syncs;
+                }
+                if (err) {
+                    std::cerr << "fdatasync failed: " << strerror(-err) << std::endl;
+                    break;
+                }
+            }
+            end = clk.stop();
+        } else {
+            if (lseek(fd, offset, SEEK_SET) == (off_t)-1) {
+                std::cerr << "lseek failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            start = clk.start();
+            n = read(fd, buffer, o.buffer_size);
+            end = clk.stop();
+        }
+        if (n != (ssize_t)o.buffer_size) {
+            std::cerr << (is_write ? "Error writing data or short write: " : "Error reading data or short read: ")
+                      << strerror(errno) << std::endl;
+            break;
+        }
+        if (due) r.hist(is_write).record(clk.to_ns(end - due));
+        else r.hist(is_write).record_corrected(clk.to_ns(end - start), o.expected_interval_ns);
+        ++r.ops;
+        r.bytes += o.buffer_size;
+    }
+    r.loop_end = std::chrono::steady_clock::now();
+    r.elapsed_s = std::chrono::duration<double>(r.loop_end - r.loop_start).count();
+    finish_schedule(r, sched);
+    return r;
+}
+
+// Keep up to iodepth IOs in flight on an io_uring. Each slot owns one buffer;
+// latency is measured per IO from the io_uring_enter that submitted it (with
+// --rate: from its scheduled time) to the moment its completion is reaped.
+// Paced IOs go out when due and a slot is free; until then the loop polls
+// the completion queue instead of blocking in io_uring_enter.
+static IoResult run_uring(int fd, int read_pct, const BenchOptions& o, const JobSpace& js) {
+    IoResult r;
+    OpStream ops(o, js, read_pct);
+    const unsigned depth = std::max(1u, o.iodepth);
+    IoUring ring;
+    int rc = ring.init(depth);
+    if (rc < 0) {
+        std::cerr << "io_uring setup failed: " << strerror(-rc) << std::endl;
+        return r;
+    }
+
+    std::vector<void*> bufs(depth);
+    std::vector<iovec> iovs(depth);
+    for (unsigned s = 0; s < depth; ++s) {
+        bufs[s] = aligned_malloc(o.buffer_size, o.alignment);
+        if (!bufs[s]) {
+            std::cerr << "Error allocating aligned memory" << std::endl;
+            for (unsigned j = 0; j < s; ++j) aligned_free(bufs[j]);
+            return r;
+        }
+        std::memset(bufs[s], 'A', o.buffer_size);
+        iovs[s] = iovec{bufs[s], o.buffer_size};
+    }
+    bool fixed_bufs = o.fixed_bufs;
+    if (fixed_bufs && (rc = ring.register_buffers(iovs.data(), depth)) < 0) {
+        std::cerr << "Warning: registering buffers failed (" << strerror(-rc) << "), using plain READ/WRITE" << std::endl;
+        fixed_bufs = false;
+    }
+    bool fixed_files = o.fixed_files;
+    if (fixed_files && (rc = ring.register_files(&fd, 1)) < 0) {
+        std::cerr << "Warning: registering file failed (" << strerror(-rc) << "), using plain fd" << std::endl;
+        fixed_files = false;
+    }
+
+    const TscClock& clk = TscClock::instance();
+    std::vector<uint64_t> submit_time(depth); // ticks
+    std::vector<char> slot_is_write(depth, 0);
+    std::vector<unsigned> free_slots(depth), batch;
+    std::iota(free_slots.begin(), free_slots.end(), 0u);
+    batch.reserve(depth);
+    uint64_t issued = 0, completed = 0;
+    const uint64_t total = (uint64_t)std::max(0, o.num_tests);
+    bool failed = false;
+
+    r.loop_start = std::chrono::steady_clock::now();
+    OpenLoopSchedule sched = job_schedule(o, js);
+    const bool paced = sched.enabled();
+    while (completed < total && !failed) {
+        batch.clear();
+        const uint64_t poll = paced ? clk.now() : 0;
+        while (!free_slots.empty() && issued < total) {
+            if (paced && sched.due(issued) > poll) break; // not due yet
+            io_uring_sqe* sqe = ring.get_sqe();
+            if (!sqe) break;
+            unsigned slot = free_slots.back();
+            free_slots.pop_back();
+            off_t offset;
+            bool is_write = ops.next(offset);
+            slot_is_write[slot] = is_write;
+            if (fixed_bufs) {
+                sqe->opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe->buf_index = (uint16_t)slot;
+            } else {
+                sqe->opcode = is_write ? IORING_OP_WRITE : IORING_OP_READ;
+            }
+            sqe->fd = fixed_files ? 0 : fd;
+            if (fixed_files) sqe->flags |= IOSQE_FIXED_FILE;
+            sqe->addr = (uint64_t)(uintptr_t)bufs[slot];
+            sqe->len = (uint32_t)o.buffer_size;
+            sqe->off = (uint64_t)offset;
+            if (is_write && o.durability == Durability::RwfDsync) sqe->rw_flags = RWF_DSYNC;
+            sqe->user_data = slot;
+            if (paced) {
+                submit_time[slot] = sched.due(issued);
+                sched.note_issue(submit_time[slot], poll);
+            }
+            batch.push_back(slot);
+            ++issued;
+        }
+        if (!paced) {
+            uint64_t now = clk.start();
+            for (unsigned slot : batch) submit_time[slot] = now;
+        }
+        // paced with a free slot: the next IO may come due before any
+        // completion, so poll the CQ instead of blocking for one
+        const unsigned wait_nr = (paced && issued < total && !free_slots.empty()) ? 0 : 1;
+        int ret = (batch.empty() && wait_nr == 0) ? 0 : ring.submit_and_wait(wait_nr);
+        if (ret < 0 && ret != -EINTR) {
+            std::cerr << "io_uring_enter failed: " << strerror(-ret) << std::endl;
+            break;
+        }
+        while (io_uring_cqe* cqe = ring.peek_cqe()) {
+            unsigned slot = (unsigned)cqe->user_data;
+            int res = cqe->res;
+            ring.cqe_seen();
+            uint64_t end = clk.stop();
+            free_slots.push_back(slot);
+            ++completed;
+            bool is_write = slot_is_write[slot];
+            if (res != (int)o.buffer_size) {
+                std::cerr << (is_write ? "Error writing data or short write: " : "Error reading data or short read: ")
+                          << (res < 0 ? strerror(-res) : "short transfer") << std::endl;
+                failed = true;
+                continue;
+            }
+            if (paced) r.hist(is_write).record(clk.to_ns(end - submit_time[slot]));
+            else r.hist(is_write).record_corrected(clk.to_ns(end - submit_time[slot]), o.expected_interval_ns);
+            ++r.ops;
+            r.bytes += o.buffer_size;
+        }
+    }
+    r.loop_end = std::chrono::steady_clock::now();
+    r.elapsed_s = std::chrono::duration<double>(r.loop_end - r.loop_start).count();
+    finish_schedule(r, sched);
+
+    // drain anything still in flight before the buffers go away
+    while (issued > completed) {
+        if (ring.submit_and_wait(1) < 0) break;
+        while (ring.peek_cqe()) { ring.cqe_seen(); ++completed; }
+    }
+    ring.close();
+    for (void* b : bufs) aligned_free(b);
+    return r;
+}
+
+// Untimed preparation of a write file so the run measures overwrites of
+// allocated blocks instead of allocation: optional fallocate (plain, or
+// FALLOC_FL_ZERO_RANGE) over [0, bytes), then an optional sequential pre-fill
+// pass with 1MiB writes followed by fdatasync.
+enum class Prealloc { None, Fallocate, ZeroRange };
+
+static bool prepare_write_file(int fd, const std::string& path, off_t bytes, Prealloc prealloc, bool prefill, size_t align) {
+    const double mib = bytes / (1024.0 * 1024.0);
+    if (prealloc != Prealloc::None) {
+        auto t0 = std::chrono::steady_clock::now();
+        int mode = prealloc == Prealloc::ZeroRange ? FALLOC_FL_ZERO_RANGE : 0;
+        if (fallocate(fd, mode, 0, bytes) != 0) {
+            std::cerr << "fallocate" << (mode ? "(FALLOC_FL_ZERO_RANGE)" : "") << " on '" << path << "' failed: "
+                      << strerror(errno) << std::endl;
+            return false;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Setup: " << (mode ? "zero-range" : "fallocate") << " " << mib << " MiB of '" << path
+                  << "' in " << ms << " ms" << std::endl;
+    }
+    if (prefill) {
+        const size_t chunk = std::max<size_t>(align, 1 << 20);
+        void* buf = aligned_malloc(chunk, align);
+        if (!buf) {
+            std::cerr << "Error allocating pre-fill buffer" << std::endl;
+            return false;
+        }
+        std::memset(buf, 'P', chunk);
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = true;
+        for (off_t off = 0; off < bytes && ok; ) {
+            size_t len = (size_t)std::min<off_t>((off_t)chunk, bytes - off);
+            ssize_t n = pwrite(fd, buf, len, off);
+            if (n <= 0) {
+                std::cerr << "Pre-fill of '" << path << "' failed: " << strerror(errno) << std::endl;
+                ok = false;
+                break;
+            }
+            off += n;
+        }
+        aligned_free(buf);
+        if (ok && fdatasync(fd) != 0) {
+            std::cerr << "fdatasync after pre-fill failed: " << strerror(errno) << std::endl;
+            ok = false;
+        }
+        if (!ok) return false;
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Setup: pre-filled " << mib << " MiB of '" << path << "' in " << s * 1000.0 << " ms ("
+                  << (s > 0 ? mib / s : 0.0) << " MiB/s)" << std::endl;
+    }
+    return true;
+}
+
+// Map the job's region and touch it with memcpy: reads copy one IO worth of
+// bytes out of the mapping, writes copy into it (plus msync of the range
+// with --msync). Fault counts come from RUSAGE_THREAD around the timed loop,
+// so MAP_POPULATE / madvise(WILLNEED) shift faults into the untimed setup.
+static IoResult run_mmap(int fd, int read_pct, const BenchOptions& o, void* buffer, const JobSpace& js) {
+    IoResult r;
+    OpStream ops(o, js, read_pct);
+    const off_t map_off = js.base_block * (off_t)o.alignment;
+    const size_t map_len = (size_t)js.max_blocks * o.alignment;
+    const int prot = PROT_READ | (read_pct < 100 ? PROT_WRITE : 0);
+
+    auto s0 = std::chrono::steady_clock::now();
+    void* m = mmap(nullptr, map_len, prot, MAP_SHARED | (o.map_populate ? MAP_POPULATE : 0), fd, map_off);
+    if (m == MAP_FAILED) {
+        std::cerr << "mmap failed: " << strerror(errno) << std::endl;
+        return r;
+    }
+    if (o.map_advice >= 0 && madvise(m, map_len, o.map_advice) != 0)
+        std::cerr << "Warning: madvise failed: " << strerror(errno) << std::endl;
+    r.setup_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - s0).count();
+
+    char* base = (char*)m;
+    const long page = sysconf(_SC_PAGESIZE);
+    rusage ru0, ru1;
+    const TscClock& clk = TscClock::instance();
+    getrusage(RUSAGE_THREAD, &ru0);
+    r.loop_start = std::chrono::steady_clock::now();
+    OpenLoopSchedule sched = job_schedule(o, js);
+    for (int i = 0; i < o.num_tests; ++i) {
+        const uint64_t due = sched.enabled() ? sched.wait((uint64_t)i) : 0;
+        off_t offset;
+        bool is_write = ops.next(offset);
+        char* p = base + (offset - map_off);
+        uint64_t start = clk.start();
+        if (is_write) {
+            std::memcpy(p, buffer, o.buffer_size);
+            if (o.map_msync) {
+                char* ps = (char*)((uintptr_t)p & ~(uintptr_t)(page - 1));
+                if (msync(ps, (size_t)(p + o.buffer_size - ps), MS_SYNC) != 0) {
+                    std::cerr << "msync failed: " << strerror(errno) << std::endl;
+                    break;
+                }
+            }
+        } else {
+            std::memcpy(buffer, p, o.buffer_size);
+        }
+        asm volatile("" ::: "memory"); // keep the copy inside the timed window
+        uint64_t end = clk.stop();
+        if (due) r.hist(is_write).record(clk.to_ns(end - due));
+        else r.hist(is_write).record_corrected(clk.to_ns(end - start), o.expected_interval_ns);
+        ++r.ops;
+        r.bytes += o.buffer_size;
+    }
+    r.loop_end = std::chrono::steady_clock::now();
+    r.elapsed_s = std::chrono::duration<double>(r.loop_end - r.loop_start).count();
+    finish_schedule(r, sched);
+    getrusage(RUSAGE_THREAD, &ru1);
+    r.major_faults = (uint64_t)(ru1.ru_majflt - ru0.ru_majflt);
+    r.minor_faults = (uint64_t)(ru1.ru_minflt - ru0.ru_minflt);
+    munmap(m, map_len);
+    return r;
+}
+
+static bool pin_self_to_cpu(int cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) {
+        std::cerr << "Warning: pthread_setaffinity_np failed for cpu " << cpu << " (rc=" << rc << ")\n";
+        return false;
+    }
+    return true;
+}
+
+// Run one engine instance per fd on its own thread. All jobs allocate their
+// buffers, pin themselves and then wait on a start barrier so they hit the
+// device together. wall_s runs from the earliest start to the latest end of
+// the jobs' timed loops, so per-engine setup after the barrier (ring init,
+// buffer registration, mmap) and teardown do not dilute the aggregate.
+template<typename Engine>
+static std::vector<IoResult> run_jobs(const std::vector<int>& fds, const std::vector<JobSpace>& spaces,
+                                      const BenchOptions& o, Engine&& engine, double& wall_s) {
+    const size_t jobs = fds.size();
+    std::vector<IoResult> results(jobs);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> ths;
+    for (size_t j = 0; j < jobs; ++j) {
+        ths.emplace_back([&, j] {
+            if (!o.cpus.empty()) pin_self_to_cpu(o.cpus[j % o.cpus.size()]);
+            void* buf = aligned_malloc(o.buffer_size, o.alignment);
+            if (buf) std::memset(buf, 'A', o.buffer_size);
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            if (buf) results[j] = engine(fds[j], buf, spaces[j]);
+            else std::cerr << "Error allocating aligned memory for job " << j << std::endl;
+            aligned_free(buf);
+        });
+    }
+    while (ready.load(std::memory_order_acquire) < jobs) std::this_thread::yield();
+    go.store(true, std::memory_order_release);
+    for (auto& t : ths) t.join();
+    std::chrono::steady_clock::time_point first{}, last{};
+    for (const IoResult& r : results) {
+        if (r.loop_end == std::chrono::steady_clock::time_point{}) continue; // setup failed, never timed
+        if (first == std::chrono::steady_clock::time_point{} || r.loop_start < first) first = r.loop_start;
+        last = std::max(last, r.loop_end);
+    }
+    wall_s = std::chrono::duration<double>(last - first).count();
+    return results;
+}
+
 int main(int argc, char** argv) {
     // Defaults
     std::string read_path = "/media/ashish/nvme9100/data.txt"; // change as needed
     std::string write_path = "/tmp/nvme_write_bench.dat";
-    size_t buffer_size = 4096; // bytes
-    size_t alignment = 4096;
-    int num_tests = 10000;
+    BenchOptions o;
     bool use_odirect = true;
     bool do_read = true;
     bool do_write = true;
+    bool do_mixed = false;
     bool keep_write_file = false;
+    bool reuse_file = false;  // keep and overwrite an existing write file instead of a fresh one
+    Prealloc prealloc = Prealloc::None;
+    bool prefill = false;
+    std::string mode = "both";
+    ReportFormat format = ReportFormat::Text;
+    auto advice_name = [](int a) {
+        switch (a) {
+            case MADV_RANDOM: return "random";
+            case MADV_SEQUENTIAL: return "sequential";
+            case MADV_WILLNEED: return "willneed";
+            case MADV_NORMAL: return "normal";
+        }
+        return "none";
+    };
     bool quick = false;
+    std::string hist_out; // --hist-out PREFIX: dump merged histograms as PREFIX.{read,write}.hist
+    std::string read_region = "100%";  // of the read file/device
+    std::string write_region = "256M"; // per job
+    bool write_pattern_set = false;
 
+    enum { OPT_NO_FIXED_BUFS = 256, OPT_NO_FIXED_FILES, OPT_JOBS, OPT_CPUS, OPT_SHARED_FILE, OPT_HIST_OUT,
+           OPT_PATTERN, OPT_WRITE_PATTERN, OPT_STRIDE, OPT_ZIPF_THETA, OPT_READ_PCT, OPT_READ_REGION, OPT_WRITE_REGION,
+           OPT_DURABILITY, OPT_SYNC_EVERY, OPT_GROUP_DELAY_US, OPT_PREALLOC, OPT_PREFILL, OPT_REUSE_FILE,
+           OPT_MAP_POPULATE, OPT_MADVISE, OPT_MSYNC, OPT_FORMAT, OPT_RATE, OPT_EXPECTED_INTERVAL_US, OPT_SEED };
     const struct option longopts[] = {
         {"read-path", required_argument, nullptr, 'r'},
         {"write-path", required_argument, nullptr, 'w'},
-        {"mode", required_argument, nullptr, 'm'}, // read, write, both
+        {"mode", required_argument, nullptr, 'm'}, // read, write, both, mixed
         {"num-tests", required_argument, nullptr, 'n'},
         {"no-odirect", no_argument, nullptr, 'N'},
         {"quick", no_argument, nullptr, 'q'},
         {"keep-write-file", no_argument, nullptr, 'k'},
         {"buffer-size", required_argument, nullptr, 'b'},
+        {"engine", required_argument, nullptr, 'e'}, // sync, uring
+        {"iodepth", required_argument, nullptr, 'd'},
+        {"no-fixed-bufs", no_argument, nullptr, OPT_NO_FIXED_BUFS},
+        {"no-fixed-files", no_argument, nullptr, OPT_NO_FIXED_FILES},
+        {"jobs", required_argument, nullptr, OPT_JOBS},
+        {"cpus", required_argument, nullptr, OPT_CPUS}, // e.g. 2,3,4,5
+        {"shared-file", no_argument, nullptr, OPT_SHARED_FILE},
+        {"hist-out", required_argument, nullptr, OPT_HIST_OUT},
+        {"pattern", required_argument, nullptr, OPT_PATTERN}, // rand, seq, stride, zipf
+        {"write-pattern", required_argument, nullptr, OPT_WRITE_PATTERN},
+        {"stride", required_argument, nullptr, OPT_STRIDE},
+        {"zipf-theta", required_argument, nullptr, OPT_ZIPF_THETA},
+        {"read-pct", required_argument, nullptr, OPT_READ_PCT},
+        {"read-region", required_argument, nullptr, OPT_READ_REGION},
+        {"write-region", required_argument, nullptr, OPT_WRITE_REGION},
+        {"durability", required_argument, nullptr, OPT_DURABILITY}, // none, odsync, fdatasync, rwf-dsync, group
+        {"sync-every", required_argument, nullptr, OPT_SYNC_EVERY},
+        {"group-delay-us", required_argument, nullptr, OPT_GROUP_DELAY_US},
+        {"prealloc", optional_argument, nullptr, OPT_PREALLOC}, // fallocate (default), zero-range
+        {"prefill", no_argument, nullptr, OPT_PREFILL},
+        {"reuse-file", no_argument, nullptr, OPT_REUSE_FILE},
+        {"map-populate", no_argument, nullptr, OPT_MAP_POPULATE},
+        {"madvise", required_argument, nullptr, OPT_MADVISE}, // random, sequential, willneed, normal
+        {"msync", no_argument, nullptr, OPT_MSYNC},
+        {"format", required_argument, nullptr, OPT_FORMAT}, // text, json, csv
+        {"rate", required_argument, nullptr, OPT_RATE}, // ops/s over all jobs: open loop
+        {"expected-interval-us", required_argument, nullptr, OPT_EXPECTED_INTERVAL_US},
+        {"seed", required_argument, nullptr, OPT_SEED},
         {0,0,0,0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "r:w:m:n:Nqkb:", longopts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "r:w:m:n:Nqkb:e:d:", longopts, nullptr)) != -1) {
         switch (opt) {
             case 'r': read_path = optarg; break;
             case 'w': write_path = optarg; break;
             case 'm': {
                 std::string m = optarg;
+                mode = m;
+                do_mixed = false;
                 if (m == "read") { do_read = true; do_write = false; }
                 else if (m == "write") { do_read = false; do_write = true; }
+                else if (m == "mixed") { do_read = false; do_write = false; do_mixed = true; }
                 else { do_read = true; do_write = true; }
                 break;
             }
-            case 'n': num_tests = atoi(optarg); break;
+            case 'n': o.num_tests = atoi(optarg); break;
             case 'N': use_odirect = false; break;
             case 'q': quick = true; break;
             case 'k': keep_write_file = true; break;
-            case 'b': buffer_size = (size_t)atoi(optarg); break;
-            default: break;
+            case 'b': o.buffer_size = (size_t)atoi(optarg); break;
+            case 'e': o.engine = optarg; break;
+            case 'd': o.iodepth = (unsigned)std::max(1, atoi(optarg)); break;
+            case OPT_NO_FIXED_BUFS: o.fixed_bufs = false; break;
+            case OPT_NO_FIXED_FILES: o.fixed_files = false; break;
+            case OPT_JOBS: o.jobs = std::max(1, atoi(optarg)); break;
+            case OPT_CPUS: {
+                std::stringstream ss(optarg);
+                std::string tok;
+                while (std::getline(ss, tok, ',')) if (!tok.empty()) o.cpus.push_back(atoi(tok.c_str()));
+                break;
+            }
+            case OPT_SHARED_FILE: o.shared_file = true; break;
+            case OPT_HIST_OUT: hist_out = optarg; break;
+            case OPT_PATTERN:
+            case OPT_WRITE_PATTERN: {
+                Pattern p;
+                if (!parse_pattern(optarg, p)) {
+                    std::cerr << "Unknown pattern '" << optarg << "' (expected rand, seq, stride or zipf)" << std::endl;
+                    return 1;
+                }
+                if (opt == OPT_PATTERN) o.read_pattern = p;
+                else { o.write_pattern = p; write_pattern_set = true; }
+                break;
+            }
+            case OPT_STRIDE: {
+                uint64_t b = 0;
+                if (!parse_region(optarg, 0, b) || b == 0) {
+                    std::cerr << "Bad --stride '" << optarg << "'" << std::endl;
+                    return 1;
+                }
+                o.stride_bytes = b;
+                break;
+            }
+            case OPT_ZIPF_THETA: o.zipf_theta = atof(optarg); break;
+            case OPT_READ_PCT: o.read_pct = std::clamp(atoi(optarg), 0, 100); break;
+            case OPT_READ_REGION: read_region = optarg; break;
+            case OPT_WRITE_REGION: write_region = optarg; break;
+            case OPT_DURABILITY:
+                if (!parse_durability(optarg, o.durability)) {
+                    std::cerr << "Unknown durability mode '" << optarg
+                              << "' (expected none, odsync, fdatasync, rwf-dsync or group)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_SYNC_EVERY: o.sync_every = std::max(1, atoi(optarg)); break;
+            case OPT_GROUP_DELAY_US: o.group_delay_us = (unsigned)std::max(0, atoi(optarg)); break;
+            case OPT_PREALLOC: {
+                std::string m = optarg ? optarg : "fallocate";
+                if (m == "fallocate") prealloc = Prealloc::Fallocate;
+                else if (m == "zero-range") prealloc = Prealloc::ZeroRange;
+                else if (m == "none") prealloc = Prealloc::None;
+                else {
+                    std::cerr << "Unknown --prealloc mode '" << m << "' (expected fallocate, zero-range or none)" << std::endl;
+                    return 1;
+                }
+                break;
+            }
+            case OPT_PREFILL: prefill = true; break;
+            case OPT_REUSE_FILE: reuse_file = true; break;
+            case OPT_MAP_POPULATE: o.map_populate = true; break;
+            case OPT_MADVISE: {
+                std::string a = optarg;
+                if (a == "random") o.map_advice = MADV_RANDOM;
+                else if (a == "sequential") o.map_advice = MADV_SEQUENTIAL;
+                else if (a == "willneed") o.map_advice = MADV_WILLNEED;
+                else if (a == "normal") o.map_advice = MADV_NORMAL;
+                else {
+                    std::cerr << "Unknown --madvise '" << a << "' (expected random, sequential, willneed or normal)" << std::endl;
+                    return 1;
+                }
+                break;
+            }
+            case OPT_MSYNC: o.map_msync = true; break;
+            case OPT_FORMAT:
+                if (!parse_report_format(optarg, format)) {
+                    std::cerr << "Unknown format '" << optarg << "' (expected text, json or csv)" << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_RATE: o.rate = atof(optarg); break;
+            case OPT_EXPECTED_INTERVAL_US: o.expected_interval_ns = (uint64_t)(atof(optarg) * 1000.0); break;
+            case OPT_SEED: o.seed = std::strtoull(optarg, nullptr, 0); break;
+            default: return 1; // getopt_long already printed what was wrong
         }
     }
+    // --pattern applies to both directions unless --write-pattern overrides it
+    if (!write_pattern_set) o.write_pattern = o.read_pattern;
+
+    if (o.engine != "sync" && o.engine != "uring" && o.engine != "mmap") {
+        std::cerr << "Unknown engine '" << o.engine << "' (expected sync, uring or mmap)" << std::endl;
+        return 1;
+    }
+    if (o.engine != "uring" && o.iodepth > 1) {
+        std::cerr << "Note: --iodepth only applies to --engine uring; " << o.engine << " runs at QD1" << std::endl;
+        o.iodepth = 1;
+    }
+    if (o.engine == "mmap" && o.durability != Durability::None) {
+        std::cerr << "--durability does not apply to --engine mmap; use --msync" << std::endl;
+        return 1;
+    }
+    // the mapping covers max_blocks * alignment bytes (the file is only
+    // extended that far); a larger copy at the last block would run off it
+    if (o.engine == "mmap" && o.buffer_size > o.alignment) {
+        std::cerr << "--engine mmap needs --buffer-size <= the " << o.alignment << "-byte block size (got "
+                  << o.buffer_size << ")" << std::endl;
+        return 1;
+    }
+    if (o.engine == "uring" && (o.durability == Durability::Fdatasync || o.durability == Durability::Group)) {
+        std::cerr << "--durability " << durability_name(o.durability) << " is only supported with --engine sync" << std::endl;
+        return 1;
+    }
+    if (o.durability == Durability::Group && o.jobs > 1 && !o.shared_file) {
+        std::cerr << "Note: --durability group shares one file between writers; enabling --shared-file" << std::endl;
+        o.shared_file = true;
+    }
+    if (o.zipf_theta <= 0.0 || o.zipf_theta == 1.0) {
+        std::cerr << "--zipf-theta must be > 0 and != 1" << std::endl;
+        return 1;
+    }
+    if (o.stride_bytes < o.alignment) o.stride_bytes = o.alignment;
+    if (o.rate < 0.0) {
+        std::cerr << "--rate must be >= 0 ops/s (0 = closed loop)" << std::endl;
+        return 1;
+    }
+    if (o.rate > 0.0 && o.expected_interval_ns) {
+        std::cerr << "Note: --expected-interval-us only applies to closed-loop runs; --rate already measures from the scheduled start" << std::endl;
+        o.expected_interval_ns = 0;
+    }
 
     if (quick) {
-        num_tests = std::max(100, std::min(1000, num_tests));
+        o.num_tests = std::max(100, std::min(1000, o.num_tests));
     }
 
-    // allocate aligned buffer
-    void* buffer = aligned_malloc(buffer_size, alignment);
-    if (!buffer) {
-        std::cerr << "Error allocating aligned memory" << std::endl;
-        return 1;
+    // With --format json|csv the human text goes to stderr and stdout carries
+    // only the structured report written at exit.
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
+    // calibrate the TSC once, before any job starts timing
+    const TscClock& clk = TscClock::instance();
+    if (!clk.uses_tsc()) std::cerr << "Note: no invariant TSC; timing with steady_clock" << std::endl;
+    BenchReport breport("myapp");
+    breport.clock_source(clk.source());
+    breport.option("mode", mode);
+    breport.option("engine", o.engine);
+    breport.option("iodepth", o.iodepth);
+    breport.option("jobs", o.jobs);
+    breport.option("num_tests", o.num_tests);
+    breport.option("buffer_size", o.buffer_size);
+    breport.option("odirect", use_odirect ? "yes" : "no");
+    breport.option("pattern", pattern_name(o.read_pattern));
+    breport.option("write_pattern", pattern_name(o.write_pattern));
+    breport.option("seed", o.seed);
+    breport.option("read_region", read_region);
+    breport.option("write_region", write_region);
+    if (do_mixed) breport.option("read_pct", o.read_pct);
+    breport.option("durability", durability_name(o.durability));
+    if (o.durability == Durability::Fdatasync) breport.option("sync_every", o.sync_every);
+    breport.option("load", o.rate > 0.0 ? "open" : "closed");
+    if (o.rate > 0.0) breport.option("rate", o.rate);
+    if (o.expected_interval_ns) breport.option("expected_interval_us", o.expected_interval_ns / 1000.0);
+    if (o.engine == "mmap") {
+        breport.option("map_populate", o.map_populate ? "yes" : "no");
+        breport.option("madvise", advice_name(o.map_advice));
+        breport.option("msync", o.map_msync ? "yes" : "no");
     }
 
-    // Helper percentile (interpolated) lambda
-    auto interpolated_percentile = [](const std::vector<double>& sorted, double p) -> double {
-        if (sorted.empty()) return 0.0;
-        if (p <= 0.0) return sorted.front();
-        if (p >= 100.0) return sorted.back();
-        double pos = (p/100.0) * (sorted.size() - 1);
-        size_t idx = (size_t)floor(pos);
-        double frac = pos - idx;
-        if (idx + 1 < sorted.size()) {
-            return sorted[idx] + frac * (sorted[idx+1] - sorted[idx]);
-        } else {
-            return sorted[idx];
+    // Region (bytes) from a size or percentage spec of file_bytes, in whole
+    // alignment blocks; with cap it never exceeds a known file/device size.
+    auto region_blocks = [&](const std::string& spec, uint64_t file_bytes, bool cap, off_t& blocks) {
+        uint64_t bytes = 0;
+        if (!parse_region(spec, file_bytes, bytes)) {
+            std::cerr << "Bad region '" << spec << "' (expected e.g. 256M, 4G or 50%)" << std::endl;
+            return false;
         }
+        if (cap && file_bytes && bytes > file_bytes) bytes = file_bytes;
+        blocks = (off_t)(bytes / o.alignment);
+        if (blocks <= 0) {
+            std::cerr << "Region '" << spec << "' is smaller than one " << o.alignment << "-byte block"
+                      << (file_bytes ? "" : " (file size unknown or empty)") << std::endl;
+            return false;
+        }
+        return true;
     };
 
-    // Reusable stats printer lambda
-    auto print_stats = [&](const std::vector<double>& samples, const std::string& title) {
-        if (samples.empty()) {
+    // Reusable stats printer lambda; percentiles come from the histogram
+    // (bucket upper bound, <1% relative error), printed in microseconds.
+    auto print_stats = [&](const HdrHistogram& h, const std::string& title) {
+        if (h.empty()) {
             std::cout << title << ": no samples" << std::endl;
             return;
         }
-        std::vector<double> sorted = samples;
-        std::sort(sorted.begin(), sorted.end());
-        int n = (int)sorted.size();
-        double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
-        double minv = sorted.front();
-        double maxv = sorted.back();
-        double p90 = interpolated_percentile(sorted, 90.0);
-        double p95 = interpolated_percentile(sorted, 95.0);
-        double p99 = interpolated_percentile(sorted, 99.0);
-        double p999 = interpolated_percentile(sorted, 99.9);
-        double p9995 = interpolated_percentile(sorted, 99.95);
-        double p9999 = interpolated_percentile(sorted, 99.99);
-        double p99999 = interpolated_percentile(sorted, 99.999);
-
-        std::cout << title << " over " << n << " samples:\n";
-        std::cout << "  mean: " << mean << " us\n";
-        std::cout << "  min: " << minv << " us\n";
-        std::cout << "  max: " << maxv << " us\n";
-        std::cout << "  p90: " << p90 << " us\n";
-        std::cout << "  p95: " << p95 << " us\n";
-        std::cout << "  p99: " << p99 << " us\n";
-        std::cout << "  p99.9: " << p999 << " us\n";
-        std::cout << "  p99.95: " << p9995 << " us\n";
-        std::cout << "  p99.99: " << p9999 << " us\n";
-        std::cout << "  p99.999: " << p99999 << " us" << std::endl;
+        auto us = [&](double p) { return h.percentile(p) / 1000.0; };
+        std::cout << title << " over " << h.count() << " samples:\n";
+        std::cout << "  mean: " << h.mean() / 1000.0 << " us\n";
+        std::cout << "  min: " << h.min() / 1000.0 << " us\n";
+        std::cout << "  max: " << h.max() / 1000.0 << " us\n";
+        std::cout << "  p90: " << us(90.0) << " us\n";
+        std::cout << "  p95: " << us(95.0) << " us\n";
+        std::cout << "  p99: " << us(99.0) << " us\n";
+        std::cout << "  p99.9: " << us(99.9) << " us\n";
+        std::cout << "  p99.95: " << us(99.95) << " us\n";
+        std::cout << "  p99.99: " << us(99.99) << " us\n";
+        std::cout << "  p99.999: " << us(99.999) << " us" << std::endl;
     };
 
-    // Seed rand
-    srand((unsigned)time(nullptr));
+    // Throughput line printed under the latency block
+    auto print_throughput = [&](const IoResult& r, int read_pct, const std::string& group) {
+        if (r.ops == 0 || r.elapsed_s <= 0.0) return;
+        double iops = r.ops / r.elapsed_s;
+        double mib_s = (double)r.bytes / r.elapsed_s / (1024.0 * 1024.0);
+        breport.metric(group, "iops", iops, "ops/s", Better::Higher);
+        breport.metric(group, "bandwidth", mib_s, "MiB/s", Better::Higher);
+        if (r.syncs) breport.metric(group, "writes_per_sync", (double)r.write_ns.count() / r.syncs, "count", Better::None);
+        if (o.engine == "mmap") {
+            breport.metric(group, "major_faults", (double)r.major_faults, "count", Better::Lower);
+            breport.metric(group, "minor_faults", (double)r.minor_faults, "count", Better::Lower);
+        }
+        std::cout << "  engine: " << o.engine << " iodepth: " << o.iodepth << " jobs: " << o.jobs;
+        if (read_pct > 0) std::cout << " pattern: " << pattern_name(o.read_pattern);
+        if (read_pct < 100) std::cout << " write-pattern: " << pattern_name(o.write_pattern);
+        if (read_pct > 0 && read_pct < 100) std::cout << " read%: " << read_pct;
+        std::cout << " seed: " << o.seed;
+        std::cout << " IOPS: " << iops << " bandwidth: " << mib_s << " MiB/s" << std::endl;
+        if (o.engine == "mmap") {
+            std::cout << "  mmap: populate: " << (o.map_populate ? "yes" : "no") << " madvise: " << advice_name(o.map_advice)
+                      << (read_pct < 100 ? (o.map_msync ? " msync: yes" : " msync: no") : "")
+                      << " major faults: " << r.major_faults << " minor faults: " << r.minor_faults
+                      << " (" << (double)(r.major_faults + r.minor_faults) / r.ops << "/op)"
+                      << " setup: " << r.setup_s * 1000.0 << " ms" << std::endl;
+        }
+        if (o.rate > 0.0) {
+            // achieved well below target means the device (or the generator)
+            // could not keep up and latency includes the backlog
+            breport.metric(group, "target_rate", o.rate, "ops/s", Better::None);
+            breport.metric(group, "late_ops", (double)r.late_ops, "count", Better::Lower);
+            breport.metric(group, "max_schedule_lag", r.max_lag_ns / 1000.0, "us", Better::Lower);
+            std::cout << "  open loop: target " << o.rate << " ops/s achieved " << iops << " ops/s"
+                      << " late ops: " << r.late_ops << " (" << 100.0 * r.late_ops / r.ops << "%)"
+                      << " max schedule lag: " << r.max_lag_ns / 1000.0 << " us"
+                      << " (latency measured from scheduled start)" << std::endl;
+        }
+        if (read_pct < 100 && o.durability != Durability::None) {
+            uint64_t writes = r.write_ns.count();
+            std::cout << "  durability: " << durability_name(o.durability);
+            if (o.durability == Durability::Fdatasync) std::cout << " sync-every: " << o.sync_every;
+            if (r.syncs) std::cout << " syncs: " << r.syncs << " writes/sync: " << (double)writes / r.syncs;
+            if (writes) std::cout << " durable writes/s: " << writes / r.elapsed_s;
+            std::cout << std::endl;
+        }
+    };
+
+    // Per-job summary lines, then the merged latency distribution(s) and the
+    // aggregate throughput over the span of the jobs' timed loops. Mixed runs
+    // report reads and writes separately.
+    auto report = [&](std::vector<IoResult>& results, double wall_s, const std::string& title, int read_pct) {
+        const bool mixed = read_pct > 0 && read_pct < 100;
+        IoResult all;
+        for (size_t j = 0; j < results.size(); ++j) {
+            IoResult& r = results[j];
+            if (results.size() > 1) {
+                std::cout << "  job " << j;
+                if (!o.cpus.empty()) std::cout << " (cpu " << o.cpus[j % o.cpus.size()] << ")";
+                std::cout << ": ops=" << r.ops
+                          << " IOPS=" << (r.elapsed_s > 0 ? r.ops / r.elapsed_s : 0.0)
+                          << " MiB/s=" << (r.elapsed_s > 0 ? r.bytes / r.elapsed_s / (1024.0 * 1024.0) : 0.0);
+                for (bool w : {false, true}) {
+                    const HdrHistogram& h = r.hist(w);
+                    if (h.empty()) continue;
+                    std::cout << (mixed ? (w ? " write" : " read") : "")
+                              << " p50=" << h.percentile(50.0) / 1000.0
+                              << " p99=" << h.percentile(99.0) / 1000.0
+                              << " p99.9=" << h.percentile(99.9) / 1000.0;
+                }
+                std::cout << " us" << std::endl;
+            }
+            all.read_ns.merge(r.read_ns);
+            all.write_ns.merge(r.write_ns);
+            all.ops += r.ops;
+            all.bytes += r.bytes;
+            all.syncs += r.syncs;
+            all.major_faults += r.major_faults;
+            all.minor_faults += r.minor_faults;
+            all.setup_s = std::max(all.setup_s, r.setup_s);
+            all.late_ops += r.late_ops;
+            all.max_lag_ns = std::max(all.max_lag_ns, r.max_lag_ns);
+        }
+        all.elapsed_s = wall_s;
+        for (bool w : {false, true}) {
+            if (w ? read_pct >= 100 : read_pct <= 0) continue;
+            print_stats(all.hist(w), mixed ? title + (w ? " (writes)" : " (reads)") : title);
+            breport.latency(std::string(mixed ? "mixed-" : "") + (w ? "write" : "read"), all.hist(w), 1e-3, "us");
+            if (!hist_out.empty()) {
+                std::string path = hist_out + "." + (mixed ? "mixed-" : "") + (w ? "write" : "read") + ".hist";
+                std::ofstream os(path);
+                if (os) all.hist(w).serialize(os);
+                else std::cerr << "Error writing histogram to '" << path << "'" << std::endl;
+            }
+        }
+        print_throughput(all, read_pct, mixed ? "mixed" : read_pct >= 100 ? "read" : "write");
+    };
+
+    // --durability group: one coordinator shared by every writer of a run
+    std::unique_ptr<GroupCommit> group;
+    auto engine = [&](int read_pct) {
+        return [&o, &group, read_pct](int fd, void* buf, const JobSpace& js) {
+            if (o.engine == "uring") return run_uring(fd, read_pct, o, js);
+            if (o.engine == "mmap") return run_mmap(fd, read_pct, o, buf, js);
+            return run_sync(fd, read_pct, o, buf, js, group.get());
+        };
+    };
 
     // --- Read benchmark (if requested) ---
     if (do_read) {
         int rflags = O_RDONLY | (use_odirect ? O_DIRECT : 0);
-        int fd = open(read_path.c_str(), rflags);
-        if (fd == -1) {
+        // every job gets its own fd (and file offset for the lseek+read path)
+        std::vector<int> fds;
+        for (int j = 0; j < o.jobs; ++j) {
+            int fd = open(read_path.c_str(), rflags);
+            if (fd == -1) break;
+            fds.push_back(fd);
+        }
+        off_t max_blocks = 0;
+        if ((int)fds.size() != o.jobs) {
             std::cerr << "Error opening read path '" << read_path << "': " << strerror(errno) << std::endl;
             std::cerr << "Skipping read benchmark." << std::endl;
+        } else if (!region_blocks(read_region, fd_size_bytes(fds[0]), true, max_blocks)) {
+            std::cerr << "Skipping read benchmark." << std::endl;
         } else {
-            std::vector<double> read_samples;
-            read_samples.reserve(num_tests);
+            // all readers share the region; sequential/strided readers start
+            // evenly spread over it
+            std::vector<JobSpace> spaces;
+            for (int j = 0; j < o.jobs; ++j)
+                spaces.push_back(JobSpace{0, max_blocks, o.seed + (uint64_t)j, (uint64_t)max_blocks * j / o.jobs, j});
+            double wall_s = 0.0;
+            auto results = run_jobs(fds, spaces, o, engine(100), wall_s);
+            report(results, wall_s, std::string("NVMe read access time"), 100);
+        }
+        for (int fd : fds) close(fd);
+    }
 
-            // pick a reasonable range for random offsets (e.g., up to 1GB by default)
-            const off_t max_blocks = 1024 * 1024; // number of 4KiB blocks
+    // --- Write / mixed benchmark (if requested) ---
+    // Mixed runs use the write path(s) opened read-write, so reads look up
+    // blocks in the same file(s) the writers append to. Returns false on a
+    // setup error that makes the measurement meaningless.
+    auto run_write_side = [&](bool mixed) -> bool {
+        // one file per job (write_path.<job>) unless --shared-file, in which
+        // case job j writes its own window of a single file
+        const bool per_job_files = o.jobs > 1 && !o.shared_file;
+        std::vector<std::string> paths;
+        for (int j = 0; j < (per_job_files ? o.jobs : 1); ++j)
+            paths.push_back(per_job_files ? write_path + "." + std::to_string(j) : write_path);
 
-            for (int i = 0; i < num_tests; ++i) {
-                off_t offset = (rand() % max_blocks) * alignment;
-                if (lseek(fd, offset, SEEK_SET) == (off_t)-1) {
-                    std::cerr << "lseek failed: " << strerror(errno) << std::endl;
-                    break;
+        auto open_write = [&](const std::string& path) {
+            // a shared writable mapping needs a read-write fd
+            int access = (mixed || o.engine == "mmap") ? O_RDWR : O_WRONLY;
+            if (o.durability == Durability::ODsync) access |= O_DSYNC;
+            // without --reuse-file a leftover file (e.g. from --keep-write-file)
+            // is truncated, so the run starts from an empty sparse file
+            if (!reuse_file) access |= O_TRUNC;
+            int wflags = access | O_CREAT | (use_odirect ? O_DIRECT : 0);
+            int wfd = open(path.c_str(), wflags, 0644);
+            if (wfd == -1) {
+                if (use_odirect) {
+                    std::cerr << "Opening write path with O_DIRECT failed, retrying without O_DIRECT: " << strerror(errno) << std::endl;
+                    wflags = access | O_CREAT;
+                    wfd = open(path.c_str(), wflags, 0644);
                 }
-                auto start = std::chrono::steady_clock::now();
-                ssize_t bytes_read = read(fd, buffer, buffer_size);
-                auto end = std::chrono::steady_clock::now();
-                if (bytes_read != (ssize_t)buffer_size) {
-                    std::cerr << "Error reading data or short read: " << strerror(errno) << std::endl;
-                    break;
+                if (wfd == -1) {
+                    std::cerr << "Error opening write path '" << path << "': " << strerror(errno) << std::endl;
                 }
-                std::chrono::duration<double, std::micro> elapsed = end - start;
-                read_samples.push_back(elapsed.count());
             }
+            return wfd;
+        };
 
-            print_stats(read_samples, std::string("NVMe read access time"));
-            close(fd);
-        }
-    }
-
-    // --- Write benchmark (if requested) ---
-    if (do_write) {
-        int wflags = O_WRONLY | O_CREAT | (use_odirect ? O_DIRECT : 0);
-        int wfd = open(write_path.c_str(), wflags, 0644);
-        if (wfd == -1) {
-            if (use_odirect) {
-                std::cerr << "Opening write path with O_DIRECT failed, retrying without O_DIRECT: " << strerror(errno) << std::endl;
-                wflags = O_WRONLY | O_CREAT;
-                wfd = open(write_path.c_str(), wflags, 0644);
-            }
-            if (wfd == -1) {
-                std::cerr << "Error opening write path '" << write_path << "': " << strerror(errno) << std::endl;
-                std::cerr << "Skipping write benchmark." << std::endl;
+        if (reuse_file) {
+            for (const auto& p : paths) {
+                struct stat st;
+                if (stat(p.c_str(), &st) == 0)
+                    std::cout << "Reusing '" << p << "' (" << st.st_size / (1024.0 * 1024.0) << " MiB)" << std::endl;
+                else
+                    std::cerr << "Note: --reuse-file but '" << p << "' does not exist yet; creating it" << std::endl;
             }
         }
 
-        if (wfd != -1) {
-            // Prepare buffer contents once
-            std::memset(buffer, 'A', buffer_size);
-            std::vector<double> write_samples;
-            write_samples.reserve(num_tests);
-
-            const off_t max_write_blocks = 1024 * 64; // ~256MB window
+        std::vector<int> fds;
+        for (int j = 0; j < o.jobs; ++j) {
+            int wfd = open_write(paths[per_job_files ? j : 0]);
+            if (wfd == -1) break;
+            fds.push_back(wfd);
+        }
 
-            for (int i = 0; i < num_tests; ++i) {
-                off_t offset = (rand() % max_write_blocks) * alignment;
-                auto start = std::chrono::steady_clock::now();
-                ssize_t bytes_written = pwrite(wfd, buffer, buffer_size, offset);
-                auto end = std::chrono::steady_clock::now();
-                if (bytes_written != (ssize_t)buffer_size) {
-                    std::cerr << "Error writing data or short write: " << strerror(errno) << std::endl;
-                    break;
+        // region is per job; a percentage refers to the existing file size
+        // (split between jobs with --shared-file). Writes may extend the file.
+        bool ok = true;
+        off_t max_write_blocks = 0;
+        uint64_t existing = fds.empty() ? 0 : fd_size_bytes(fds[0]);
+        if (o.shared_file) existing /= (uint64_t)o.jobs;
+        if ((int)fds.size() != o.jobs || !region_blocks(write_region, existing, false, max_write_blocks)) {
+            std::cerr << "Skipping " << (mixed ? "mixed" : "write") << " benchmark." << std::endl;
+        } else {
+            const off_t need = (off_t)max_write_blocks * (o.shared_file ? o.jobs : 1) * (off_t)o.alignment;
+            for (int j = 0; j < (per_job_files ? o.jobs : 1) && ok; ++j)
+                ok = prepare_write_file(fds[j], paths[j], need, prealloc, prefill, o.alignment);
+            if (!ok) {
+                // a half-prepared file would mix allocation back into the numbers
+                std::cerr << "Error: preparing the " << (mixed ? "mixed" : "write") << " file failed" << std::endl;
+            } else {
+                // mixed reads and mappings must not run past EOF: extend the
+                // file(s) over the whole region (sparse unless already written)
+                if (mixed || o.engine == "mmap") {
+                    for (int j = 0; j < (per_job_files ? o.jobs : 1); ++j)
+                        if ((off_t)fd_size_bytes(fds[j]) < need && ftruncate(fds[j], need) != 0)
+                            std::cerr << "Warning: ftruncate '" << paths[j] << "' failed: " << strerror(errno) << std::endl;
                 }
-                std::chrono::duration<double, std::micro> elapsed = end - start;
-                write_samples.push_back(elapsed.count());
+                std::vector<JobSpace> spaces;
+                for (int j = 0; j < o.jobs; ++j) {
+                    off_t base = o.shared_file ? (off_t)j * max_write_blocks : 0;
+                    spaces.push_back(JobSpace{base, max_write_blocks, o.seed + 1000 + (uint64_t)j, 0, j});
+                }
+                const int read_pct = mixed ? o.read_pct : 0;
+                if (o.durability == Durability::Group) group = std::make_unique<GroupCommit>(o.group_delay_us);
+                double wall_s = 0.0;
+                auto results = run_jobs(fds, spaces, o, engine(read_pct), wall_s);
+                std::string where = per_job_files ? write_path + ".<job>" : write_path;
+                report(results, wall_s, std::string(mixed ? "Mixed access time to '" : "File write access time to '") + where + "'", read_pct);
             }
-
-            print_stats(write_samples, std::string("File write access time to '" + write_path + "'"));
-
-            close(wfd);
-            if (!keep_write_file) unlink(write_path.c_str());
         }
-    }
+        for (int fd : fds) close(fd);
+        if (!keep_write_file && !reuse_file) for (const auto& p : paths) unlink(p.c_str());
+        return ok;
+    };
+    bool ok = true;
+    if (do_write) ok = run_write_side(false);
+    if (do_mixed && ok) ok = run_write_side(true);
 
-    aligned_free(buffer);
+    std::cout.rdbuf(stdout_buf);
+    if (!ok) return 1;
+    breport.write(std::cout, format);
     return 0;
 }
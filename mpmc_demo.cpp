@@ -6,6 +6,11 @@
 #include <sstream>
 #include <iomanip>
 #include "mpmc_queue.h"
+#include "bench_report.h"
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+#include "stamped_item.h"
+#include "open_loop.h"
 
 int main(int argc, char** argv)
 {
@@ -15,6 +20,9 @@ int main(int argc, char** argv)
     uint64_t per_producer = 2000000ULL;
     bool backoff = true; // when true consumers sleep briefly when empty
     uint64_t backoff_us = 50;
+    uint64_t sample_every = 1024; // stamp every Nth item with the TSC (0 = off)
+    double target_rate = 0.0;     // total enqueue ops/s over all producers; 0 = closed loop
+    ReportFormat format = ReportFormat::Text;
 
     for (int i = 1; i < argc; ++i) {
         std::string s(argv[i]);
@@ -28,78 +36,121 @@ int main(int argc, char** argv)
             backoff = false;
         } else if (s == "--backoff-us") {
             if (i + 1 < argc) backoff_us = std::stoull(argv[++i]);
+        } else if (s == "--rate") {
+            if (i + 1 < argc) target_rate = std::stod(argv[++i]);
+        } else if (s == "--sample-every") {
+            if (i + 1 < argc) sample_every = std::stoull(argv[++i]);
+        } else if (s == "--format") {
+            if (i + 1 < argc && !parse_report_format(argv[++i], format)) {
+                std::cerr << "Unknown format '" << argv[i] << "' (expected text, json or csv)\n";
+                return 1;
+            }
         } else if ((s == "-h") || (s == "--help")) {
-            std::cout << "Usage: " << argv[0] << " [--producers N] [--consumers N] [--per-producer N] [--no-backoff] [--backoff-us N]\n";
+            std::cout << "Usage: " << argv[0] << " [--producers N] [--consumers N] [--per-producer N] [--no-backoff] [--backoff-us N] [--rate OPS] [--sample-every N] [--format text|json|csv]\n";
             return 0;
+        } else {
+            std::cerr << "Unknown option '" << s << "' (see --help)\n";
+            return 1;
         }
     }
+    // structured output owns stdout; human text moves to stderr
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
 
     const uint64_t total = per_producer * producers;
 
-    MPMCQueue<uint64_t> q{};
+    // Calibrate before the threads start so none of them pays for it mid-run.
+    const TscClock& clk = TscClock::instance();
 
     std::atomic<uint64_t> produced_sum{0};
     std::atomic<uint64_t> consumed_sum{0};
+    std::atomic<uint64_t> late_ops{0};
+    std::atomic<uint64_t> max_lag_ns{0};
+    // One histogram per consumer, merged after the join.
+    std::vector<HdrHistogram> hists(consumers);
+    uint64_t spins = 0, cas_failures = 0;
 
-    // Launch producers
-    std::vector<std::thread> pth;
-    for (unsigned int p = 0; p < producers; ++p) {
-        pth.emplace_back([p, per_producer, &q, &produced_sum]{
-            uint64_t base = uint64_t(p) * per_producer;
-            uint64_t local_sum = 0;
-            for (uint64_t i = 0; i < per_producer; ++i) {
-                uint64_t v = base + i + 1;
-                q.enqueue(v);
-                local_sum += v;
-            }
-            produced_sum.fetch_add(local_sum, std::memory_order_relaxed);
-        });
-    }
+    // Sampled items carry their enqueue time (with --rate: their scheduled
+    // time, so backpressure on a full queue is part of the latency). Returns
+    // the elapsed seconds.
+    auto run = [&](auto item_type) -> double {
+        using Item = typename decltype(item_type)::type;
+        MPMCQueue<Item> q{};
 
-    std::atomic<uint64_t> consumed_count{0};
-    std::atomic<bool> producers_done{false};
-    // Launch consumers
-    std::vector<std::thread> cth;
-    for (unsigned int c = 0; c < consumers; ++c) {
-        cth.emplace_back([&, c]{
-            uint64_t local_sum = 0;
-            uint64_t spin = 0;
-            while (true) {
-                uint64_t v;
-                if (q.try_dequeue(v)) {
+        // Launch producers
+        std::vector<std::thread> pth;
+        for (unsigned int p = 0; p < producers; ++p) {
+            pth.emplace_back([&, p]{
+                uint64_t base = uint64_t(p) * per_producer;
+                uint64_t local_sum = 0;
+                // producers split the rate and are staggered within one interval
+                OpenLoopSchedule sched;
+                if (target_rate > 0.0) sched = OpenLoopSchedule(clk, target_rate / producers, (double)p / producers);
+                for (uint64_t i = 0; i < per_producer; ++i) {
+                    const uint64_t due = sched.enabled() ? sched.wait(i) : 0;
+                    uint64_t v = base + i + 1;
+                    q.enqueue(make_item<Item>(v, (sample_every && v % sample_every == 0) ? (due ? due : clk.now()) : 0));
                     local_sum += v;
-                    uint64_t prev = consumed_count.fetch_add(1, std::memory_order_relaxed);
-                    if (prev + 1 >= total) break;
-                    spin = 0;
-                } else {
-                    // If enough items have been consumed by other threads, exit.
-                    if (consumed_count.load(std::memory_order_relaxed) >= total) break;
-                    // If producers are done and queue empty, exit
-                    if (producers_done.load(std::memory_order_relaxed)) {
-                        if (consumed_count.load(std::memory_order_relaxed) >= total) break;
-                    }
-                    // Backoff strategy: yield for a while, then sleep if enabled
-                    if (spin < 50) {
-                        ++spin;
-                        std::this_thread::yield();
-                    } else if (backoff) {
-                        std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
+                }
+                produced_sum.fetch_add(local_sum, std::memory_order_relaxed);
+                late_ops.fetch_add(sched.late_ops(), std::memory_order_relaxed);
+                uint64_t lag = sched.max_lag_ns(), prev = max_lag_ns.load(std::memory_order_relaxed);
+                while (lag > prev && !max_lag_ns.compare_exchange_weak(prev, lag, std::memory_order_relaxed)) {}
+            });
+        }
+
+        std::atomic<uint64_t> consumed_count{0};
+        std::atomic<bool> producers_done{false};
+        // Launch consumers
+        std::vector<std::thread> cth;
+        for (unsigned int c = 0; c < consumers; ++c) {
+            cth.emplace_back([&, c]{
+                uint64_t local_sum = 0;
+                uint64_t spin = 0;
+                HdrHistogram& hist = hists[c];
+                while (true) {
+                    Item v;
+                    if (q.try_dequeue(v)) {
+                        if (const uint64_t tsc = item_tsc(v)) {
+                            const uint64_t now = clk.stop();
+                            hist.record(now > tsc ? clk.to_ns(now - tsc) : 0);
+                        }
+                        local_sum += item_value(v);
+                        uint64_t prev = consumed_count.fetch_add(1, std::memory_order_relaxed);
+                        if (prev + 1 >= total) break;
+                        spin = 0;
                     } else {
-                        std::this_thread::yield();
+                        // If enough items have been consumed by other threads, exit.
+                        if (consumed_count.load(std::memory_order_relaxed) >= total) break;
+                        // If producers are done and queue empty, exit
+                        if (producers_done.load(std::memory_order_relaxed)) {
+                            if (consumed_count.load(std::memory_order_relaxed) >= total) break;
+                        }
+                        // Backoff strategy: yield for a while, then sleep if enabled
+                        if (spin < 50) {
+                            ++spin;
+                            std::this_thread::yield();
+                        } else if (backoff) {
+                            std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
+                        } else {
+                            std::this_thread::yield();
+                        }
                     }
                 }
-            }
-            consumed_sum.fetch_add(local_sum, std::memory_order_relaxed);
-        });
-    }
-
-    auto start = std::chrono::steady_clock::now();
-    for (auto &t : pth) t.join();
-    producers_done.store(true, std::memory_order_relaxed);
-    for (auto &t : cth) t.join();
-    auto end = std::chrono::steady_clock::now();
+                consumed_sum.fetch_add(local_sum, std::memory_order_relaxed);
+            });
+        }
 
-    double secs = std::chrono::duration<double>(end - start).count();
+        auto start = std::chrono::steady_clock::now();
+        for (auto &t : pth) t.join();
+        producers_done.store(true, std::memory_order_relaxed);
+        for (auto &t : cth) t.join();
+        auto end = std::chrono::steady_clock::now();
+        spins = q.stats_spins();
+        cas_failures = q.stats_cas_failures();
+        return std::chrono::duration<double>(end - start).count();
+    };
+    const double secs = sample_every ? run(std::type_identity<StampedItem>{}) : run(std::type_identity<uint64_t>{});
     uint64_t prod = produced_sum.load(std::memory_order_relaxed);
     uint64_t cons = consumed_sum.load(std::memory_order_relaxed);
     std::cout << "Produced sum=" << prod << " Consumed sum=" << cons << "\n";
@@ -109,7 +160,7 @@ int main(int argc, char** argv)
     }
 
     // Print queue instrumentation (lightweight counters)
-    std::cout << "Queue stats: spins=" << q.stats_spins() << " cas_failures=" << q.stats_cas_failures() << "\n";
+    std::cout << "Queue stats: spins=" << spins << " cas_failures=" << cas_failures << "\n";
 
     // human-readable ops/sec formatter
     auto human_rate = [](double v) {
@@ -127,5 +178,41 @@ int main(int argc, char** argv)
 
     double rate = (secs > 0.0) ? (static_cast<double>(total) / secs) : 0.0;
     std::cout << "Transferred " << total << " items in " << secs << " seconds (" << human_rate(rate) << ")\n";
+
+    HdrHistogram hist;
+    for (const auto& h : hists) hist.merge(h);
+    if (hist.count()) {
+        std::cout << "Queue latency (" << clk.source() << ", " << hist.count() << " samples): p50="
+                  << hist.percentile(50) << "ns p99=" << hist.percentile(99) << "ns p99.9=" << hist.percentile(99.9)
+                  << "ns max=" << hist.max() << "ns\n";
+    }
+    if (target_rate > 0.0) {
+        std::cout << "Open loop: target " << human_rate(target_rate) << ", late ops " << late_ops.load()
+                  << ", max schedule lag " << max_lag_ns.load() << "ns\n";
+    }
+
+    BenchReport report("mpmc_demo");
+    report.option("producers", producers);
+    report.option("consumers", consumers);
+    report.option("per_producer", per_producer);
+    report.option("backoff", backoff ? "yes" : "no");
+    report.option("backoff_us", backoff_us);
+    report.option("sample_every", sample_every);
+    report.option("item_bytes", sample_every ? sizeof(StampedItem) : sizeof(uint64_t));
+    report.option("load", target_rate > 0.0 ? "open" : "closed");
+    if (target_rate > 0.0) report.option("rate", target_rate);
+    report.clock_source(clk.source());
+    report.metric("mpmc", "items", (double)total, "count", Better::None);
+    report.metric("mpmc", "elapsed", secs, "s", Better::Lower);
+    report.metric("mpmc", "throughput", rate, "ops/s", Better::Higher);
+    report.metric("mpmc", "spins", (double)spins, "count", Better::Lower);
+    report.metric("mpmc", "cas_failures", (double)cas_failures, "count", Better::Lower);
+    report.latency("mpmc_latency", hist, 1.0, "ns");
+    if (target_rate > 0.0) {
+        report.metric("mpmc", "late_ops", (double)late_ops.load(), "count", Better::Lower);
+        report.metric("mpmc", "max_schedule_lag", (double)max_lag_ns.load(), "ns", Better::Lower);
+    }
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, format);
     return 0;
 }
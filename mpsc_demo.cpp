@@ -4,54 +4,95 @@
 #include <chrono>
 #include <atomic>
 #include "mpsc_queue.h"
+#include "bench_report.h"
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+#include "stamped_item.h"
 
-int main()
+int main(int argc, char** argv)
 {
+    ReportFormat format = ReportFormat::Text;
+    uint64_t sample_every = 1024; // stamp every Nth item with the TSC (0 = off)
+    for (int i = 1; i < argc; ++i) {
+        std::string s(argv[i]);
+        if (s == "--sample-every" && i + 1 < argc) {
+            sample_every = std::stoull(argv[++i]);
+        } else if (s == "--format" && i + 1 < argc) {
+            if (!parse_report_format(argv[++i], format)) {
+                std::cerr << "Unknown format '" << argv[i] << "' (expected text, json or csv)\n";
+                return 1;
+            }
+        } else if (s == "-h" || s == "--help") {
+            std::cout << "Usage: " << argv[0] << " [--sample-every N] [--format text|json|csv]\n";
+            return 0;
+        } else {
+            std::cerr << "Unknown option or missing value: '" << s << "' (see --help)\n";
+            return 1;
+        }
+    }
+    // structured output owns stdout; human text moves to stderr
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
+
     const unsigned int producers = 4;
     const uint64_t per_producer = 5'000'000; // adjust if needed
     const uint64_t total = per_producer * producers;
 
-    MPSCQueue<uint64_t> q(1024);
+    // Calibrate before the threads start so none of them pays for it mid-run.
+    const TscClock& clk = TscClock::instance();
+
+    HdrHistogram hist;
 
     std::atomic<uint64_t> produced_sum{0};
     std::atomic<uint64_t> consumed_sum{0};
 
-    // Launch producers
-    std::vector<std::thread> ths;
-    for (unsigned int p = 0; p < producers; ++p) {
-        ths.emplace_back([p, per_producer, &q, &produced_sum]{
-            uint64_t base = uint64_t(p) * per_producer;
+    // Sampled items carry their enqueue time. Returns the elapsed seconds.
+    auto run = [&](auto item_type) -> double {
+        using Item = typename decltype(item_type)::type;
+        MPSCQueue<Item> q(1024);
+
+        // Launch producers
+        std::vector<std::thread> ths;
+        for (unsigned int p = 0; p < producers; ++p) {
+            ths.emplace_back([p, per_producer, sample_every, &clk, &q, &produced_sum]{
+                uint64_t base = uint64_t(p) * per_producer;
+                uint64_t local_sum = 0;
+                for (uint64_t i = 0; i < per_producer; ++i) {
+                    uint64_t v = base + i + 1; // non-zero
+                    // blocking enqueue
+                    q.enqueue(make_item<Item>(v, (sample_every && v % sample_every == 0) ? clk.now() : 0));
+                    local_sum += v;
+                }
+                produced_sum.fetch_add(local_sum, std::memory_order_relaxed);
+            });
+        }
+
+        // Consumer
+        std::thread consumer([&]{
+            uint64_t got = 0;
             uint64_t local_sum = 0;
-            for (uint64_t i = 0; i < per_producer; ++i) {
-                uint64_t v = base + i + 1; // non-zero
-                // blocking enqueue
-                q.enqueue(v);
-                local_sum += v;
+            while (got < total) {
+                Item v;
+                q.dequeue(v);
+                if (const uint64_t tsc = item_tsc(v)) {
+                    const uint64_t now = clk.stop();
+                    hist.record(now > tsc ? clk.to_ns(now - tsc) : 0);
+                }
+                local_sum += item_value(v);
+                ++got;
             }
-            produced_sum.fetch_add(local_sum, std::memory_order_relaxed);
+            consumed_sum.store(local_sum, std::memory_order_relaxed);
         });
-    }
-
-    // Consumer
-    std::thread consumer([&]{
-        uint64_t got = 0;
-        uint64_t local_sum = 0;
-        while (got < total) {
-            uint64_t v;
-            q.dequeue(v);
-            local_sum += v;
-            ++got;
-        }
-        consumed_sum.store(local_sum, std::memory_order_relaxed);
-    });
 
-    auto start = std::chrono::steady_clock::now();
+        auto start = std::chrono::steady_clock::now();
 
-    for (auto &t : ths) t.join();
-    consumer.join();
+        for (auto &t : ths) t.join();
+        consumer.join();
 
-    auto end = std::chrono::steady_clock::now();
-    double secs = std::chrono::duration<double>(end - start).count();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    };
+    const double secs = sample_every ? run(std::type_identity<StampedItem>{}) : run(std::type_identity<uint64_t>{});
 
     uint64_t prod = produced_sum.load(std::memory_order_relaxed);
     uint64_t cons = consumed_sum.load(std::memory_order_relaxed);
@@ -63,5 +104,23 @@ int main()
     }
 
     std::cout << "Transferred " << total << " items in " << secs << " seconds (" << (total / secs) << " ops/s)\n";
+    if (hist.count()) {
+        std::cout << "Queue latency (" << clk.source() << ", " << hist.count() << " samples): p50="
+                  << hist.percentile(50) << "ns p99=" << hist.percentile(99) << "ns p99.9=" << hist.percentile(99.9)
+                  << "ns max=" << hist.max() << "ns\n";
+    }
+
+    BenchReport report("mpsc_demo");
+    report.option("producers", producers);
+    report.option("per_producer", per_producer);
+    report.option("sample_every", sample_every);
+    report.option("item_bytes", sample_every ? sizeof(StampedItem) : sizeof(uint64_t));
+    report.clock_source(clk.source());
+    report.metric("mpsc", "items", (double)total, "count", Better::None);
+    report.metric("mpsc", "elapsed", secs, "s", Better::Lower);
+    report.metric("mpsc", "throughput", total / secs, "ops/s", Better::Higher);
+    report.latency("mpsc_latency", hist, 1.0, "ns");
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, format);
     return 0;
 }
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "tsc_clock.h"
+
+// Fixed-rate (open-loop) schedule for the load generators.
+// - Op i is due at start + i * interval whether or not earlier ops have
+//   finished, so a stall delays every op scheduled behind it instead of
+//   quietly lowering the offered rate.
+// - Callers measure latency from the due time returned by wait(), not from
+//   when the op was actually issued; time spent queued behind a slow op is
+//   part of the latency, as it would be for a real client (no coordinated
+//   omission).
+// - When behind schedule, wait() returns at once and ops go out back to back
+//   until the schedule is caught up; late_ops() / max_lag_ns() show how far
+//   the generator itself fell behind.
+// A default-constructed schedule is disabled (closed loop); callers check
+// enabled() and time from their own start stamp instead.
+class OpenLoopSchedule {
+public:
+    OpenLoopSchedule() = default;
+
+    // ops_per_s for this generator; phase (0..1 of an interval) staggers
+    // several generators that share one target rate.
+    OpenLoopSchedule(const TscClock& clk, double ops_per_s, double phase = 0.0)
+        : clk_(&clk), interval_((double)clk.hz() / ops_per_s)
+    {
+        start_ = clk.now() + (uint64_t)(phase * interval_);
+    }
+
+    bool enabled() const noexcept { return clk_ != nullptr; }
+
+    uint64_t due(uint64_t i) const noexcept { return start_ + (uint64_t)((double)i * interval_); }
+
+    // Blocks (spinning) until op i is due and returns its due time in ticks.
+    uint64_t wait(uint64_t i) noexcept
+    {
+        const uint64_t t = due(i);
+        uint64_t now = clk_->now();
+        while (now < t) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            now = clk_->now();
+        }
+        note_issue(t, now);
+        return t;
+    }
+
+    // For callers that issue without wait() (e.g. once a queue slot frees up).
+    void note_issue(uint64_t due_ticks, uint64_t now) noexcept
+    {
+        const uint64_t lag = now > due_ticks ? now - due_ticks : 0;
+        if ((double)lag >= interval_) ++late_;
+        max_lag_ = std::max(max_lag_, lag);
+    }
+
+    // Ops issued a full interval or more after their due time.
+    uint64_t late_ops() const noexcept { return late_; }
+    uint64_t max_lag_ns() const noexcept { return clk_ ? clk_->to_ns(max_lag_) : 0; }
+
+private:
+    const TscClock* clk_ = nullptr;
+    double interval_ = 0.0; // ticks
+    uint64_t start_ = 0;
+    uint64_t late_ = 0;
+    uint64_t max_lag_ = 0;
+};
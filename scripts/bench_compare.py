@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Compare two benchmark result files written with --format json or csv.
+
+Metrics are matched by (group, name). Each metric carries its own direction
+("better": lower/higher/none); a change in the bad direction larger than the
+threshold is flagged as a regression and makes the script exit with status 1.
+
+Usage:
+  scripts/bench_compare.py baseline.json candidate.json [--threshold 5]
+  scripts/bench_compare.py old.csv new.csv --threshold 10 --metric p99 --metric iops
+"""
+import argparse
+import csv
+import json
+import sys
+
+
+def load(path):
+    """Return (meta, options, metrics) where metrics maps (group, name) -> dict."""
+    with open(path) as f:
+        text = f.read()
+    meta, options, metrics = {}, {}, {}
+    if text.lstrip().startswith("{"):
+        doc = json.loads(text)
+        meta = doc.get("meta", {})
+        options = doc.get("options", {})
+        rows = doc.get("metrics", [])
+    else:
+        body = []
+        for line in text.splitlines():
+            if line.startswith("# "):
+                key, _, value = line[2:].partition("=")
+                if key.startswith("option."):
+                    options[key[len("option."):]] = value
+                else:
+                    meta[key] = value
+            elif line.strip():
+                body.append(line)
+        rows = []
+        for r in csv.DictReader(body):
+            r = dict(r)
+            r["name"] = r.pop("metric")
+            rows.append(r)
+    for r in rows:
+        value = r.get("value")
+        try:
+            value = float(value) if value not in (None, "null") else None
+        except ValueError:
+            value = None
+        metrics[(r["group"], r["name"])] = {
+            "value": value,
+            "unit": r.get("unit", ""),
+            "better": r.get("better", "none"),
+        }
+    return meta, options, metrics
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("baseline")
+    ap.add_argument("candidate")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="percent change in the bad direction that counts as a regression (default: 5)")
+    ap.add_argument("--metric", action="append", default=[],
+                    help="only compare metrics with this name (repeatable)")
+    args = ap.parse_args()
+
+    bmeta, bopts, base = load(args.baseline)
+    cmeta, copts, cand = load(args.candidate)
+
+    for key in ("bench", "git_sha", "host", "cpu_model", "kernel", "clock_source"):
+        b, c = bmeta.get(key, "?"), cmeta.get(key, "?")
+        print(f"{key:13} {b}" + ("" if b == c else f"  ->  {c}"))
+    changed = sorted(k for k in set(bopts) | set(copts) if bopts.get(k) != copts.get(k))
+    for k in changed:
+        print(f"option {k}: {bopts.get(k, '-')} -> {copts.get(k, '-')}")
+    if changed:
+        print("warning: options differ; results may not be comparable")
+    print()
+
+    regressions = 0
+    print(f"{'group':14} {'metric':14} {'baseline':>14} {'candidate':>14} {'change':>9}  unit")
+    for key in sorted(set(base) & set(cand)):
+        group, name = key
+        if args.metric and name not in args.metric:
+            continue
+        b, c = base[key], cand[key]
+        if b["value"] is None or c["value"] is None:
+            continue
+        if b["value"] != 0:
+            pct = (c["value"] - b["value"]) / abs(b["value"]) * 100.0
+        else:
+            pct = 0.0 if c["value"] == 0 else float("inf")
+        better = b["better"]
+        worse = (better == "lower" and pct > args.threshold) or (better == "higher" and pct < -args.threshold)
+        improved = (better == "lower" and pct < -args.threshold) or (better == "higher" and pct > args.threshold)
+        flag = "  REGRESSION" if worse else ("  improved" if improved else "")
+        regressions += worse
+        print(f"{group:14} {name:14} {b['value']:14.4g} {c['value']:14.4g} {pct:+8.1f}%  {b['unit']}{flag}")
+
+    only = sorted(set(base) ^ set(cand))
+    for group, name in only:
+        side = "baseline" if (group, name) in base else "candidate"
+        print(f"{group:14} {name:14} only in {side}")
+
+    print()
+    if regressions:
+        print(f"{regressions} regression(s) beyond {args.threshold}%")
+        return 1
+    print(f"no regressions beyond {args.threshold}%")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,5 +1,8 @@
 #!/usr/bin/env bash
-# Simple benchmark wrapper: runs mpmc_demo under perf stat when available
+# Simple benchmark wrapper: runs mpmc_demo (three times under perf stat -r 3 when available),
+# saves the JSON report and optionally compares it against a baseline.
+#
+#   scripts/run_bench.sh [producers] [consumers] [per-producer] [out.json] [baseline.json]
 set -euo pipefail
 
 BIN=./build/mpmc_demo
@@ -11,18 +14,30 @@ fi
 PROD=${1:-4}
 CONS=${2:-4}
 PER=${3:-1000000}
-OUT=${4:-bench-results.txt}
+OUT=${4:-bench-results.json}
+BASELINE=${5:-}
+LOG="${OUT%.json}.log"
+
+ARGS=(--producers "$PROD" --consumers "$CONS" --per-producer "$PER" --format json)
 
 PERF=perf
+echo "Running benchmark: producers=$PROD consumers=$CONS per-producer=$PER" | tee "$LOG"
 if ! command -v $PERF >/dev/null 2>&1; then
   echo "perf not found -- will run without perf stats" >&2
-  echo "Running: $BIN --producers $PROD --consumers $CONS --per-producer $PER" >&2
-  time $BIN --producers $PROD --consumers $CONS --per-producer $PER | tee "$OUT"
-  exit 0
+  # human text goes to stderr, the JSON report to stdout
+  $BIN "${ARGS[@]}" 2> >(tee -a "$LOG" >&2) > "$OUT"
+else
+  echo "perf stat -r 3 ..." | tee -a "$LOG"
+  # counters are averaged over 3 runs; each run rewrites $OUT, so the JSON
+  # report is that of the last run rather than three concatenated documents
+  $PERF stat -e cycles,instructions,cache-references,cache-misses,context-switches -r 3 \
+    -o "${OUT%.json}.perf.txt" sh -c 'out=$1; shift; exec "$@" > "$out"' sh "$OUT" $BIN "${ARGS[@]}" \
+    2> >(tee -a "$LOG" >&2)
+  cat "${OUT%.json}.perf.txt" | tee -a "$LOG"
 fi
 
-echo "Running benchmark: producers=$PROD consumers=$CONS per-producer=$PER" | tee "$OUT"
-echo "perf stat ..." | tee -a "$OUT"
-$PERF stat -e cycles,instructions,cache-references,cache-misses,context-switches -r 3 $BIN --producers $PROD --consumers $CONS --per-producer $PER 2>&1 | tee -a "$OUT"
+echo "Done. Results in $OUT (log: $LOG)"
 
-echo "Done. Results in $OUT"
+if [[ -n "$BASELINE" ]]; then
+  python3 "$(dirname "$0")/bench_compare.py" "$BASELINE" "$OUT"
+fi
@@ -3,47 +3,54 @@
 #include <vector>
 #include <chrono>
 #include "spsc_queue.h"
+#include "bench_report.h"
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+#include "stamped_item.h"
+#include "open_loop.h"
 #include <pthread.h>
 #include <sched.h>
 #include <unistd.h>
 #include <atomic>
 
-int main()
+int main(int argc, char** argv)
 {
-    const size_t count = 1'000'000 * 500;
-    SPSCQueue<uint64_t> q(1024);
-
-    // start barrier to ensure we set affinity before the threads begin heavy work
-    std::atomic<bool> start{false};
-
-    std::thread producer([&]{
-        // wait for main to finish pinning
-        while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
-        for (uint64_t i = 1; i <= count; ++i) {
-            while (!q.enqueue(i)) {
-                // busy-wait
-                std::this_thread::yield();
+    ReportFormat format = ReportFormat::Text;
+    uint64_t sample_every = 1024;
+    uint64_t count = 1'000'000 * 500;
+    double rate = 0.0; // producer ops/s; 0 = closed loop (as fast as the queue allows)
+    for (int i = 1; i < argc; ++i) {
+        std::string s(argv[i]);
+        if (s == "--sample-every" && i + 1 < argc) {
+            sample_every = std::stoull(argv[++i]);
+        } else if ((s == "-n" || s == "--items") && i + 1 < argc) {
+            count = std::stoull(argv[++i]);
+        } else if (s == "--rate" && i + 1 < argc) {
+            rate = std::stod(argv[++i]);
+        } else if (s == "--format" && i + 1 < argc) {
+            if (!parse_report_format(argv[++i], format)) {
+                std::cerr << "Unknown format '" << argv[i] << "' (expected text, json or csv)\n";
+                return 1;
             }
+        } else if (s == "-h" || s == "--help") {
+            std::cout << "Usage: " << argv[0] << " [--items N] [--rate OPS] [--sample-every N] [--format text|json|csv]\n"
+                      << "  --rate OPS        open loop: enqueue on a fixed schedule; latency counts from the scheduled time\n"
+                      << "  --sample-every N  stamp every Nth item with the TSC and record its queue latency (0 = off)\n";
+            return 0;
+        } else {
+            std::cerr << "Unknown option or missing value: '" << s << "' (see --help)\n";
+            return 1;
         }
-    });
+    }
+    // structured output owns stdout; human text moves to stderr
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (format != ReportFormat::Text) std::cout.rdbuf(std::cerr.rdbuf());
 
-    std::thread consumer([&]{
-        // wait for main to finish pinning
-        while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
-        uint64_t expected = 1;
-        uint64_t v;
-        while (expected <= count) {
-            if (q.dequeue(v)) {
-                if (v != expected) {
-                    std::cerr << "Mismatch: got " << v << " expected " << expected << '\n';
-                    std::exit(2);
-                }
-                expected++;
-            } else {
-                std::this_thread::yield();
-            }
-        }
-    });
+    // Calibrate before the threads start so neither pays for it mid-run.
+    const TscClock& clk = TscClock::instance();
+
+    HdrHistogram hist;
+    uint64_t late_ops = 0, max_lag_ns = 0;
 
     // Determine CPU cores to use
     unsigned int ncores = std::thread::hardware_concurrency();
@@ -75,19 +82,99 @@ int main()
         std::cout << "Pinning producer to CPU " << prod_cpu << " and consumer to CPU " << cons_cpu << "\n";
     }
 
-    // Pin threads before starting the workload
-    pin_thread_to_cpu(producer, prod_cpu);
-    pin_thread_to_cpu(consumer, cons_cpu);
+    // Every sample_every-th item carries its enqueue time (with --rate: its
+    // scheduled time, so a producer stalled on a full queue still counts the
+    // wait). Returns the elapsed seconds.
+    auto run = [&](auto item_type) -> double {
+        using Item = typename decltype(item_type)::type;
+        SPSCQueue<Item> q(1024);
 
-    // start timing and release threads
-    auto start_time = std::chrono::steady_clock::now();
-    start.store(true, std::memory_order_release);
+        // start barrier to ensure we set affinity before the threads begin heavy work
+        std::atomic<bool> start{false};
 
-    producer.join();
-    consumer.join();
-    auto end = std::chrono::steady_clock::now();
+        std::thread producer([&]{
+            // wait for main to finish pinning
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            OpenLoopSchedule sched = rate > 0.0 ? OpenLoopSchedule(clk, rate) : OpenLoopSchedule();
+            for (uint64_t i = 1; i <= count; ++i) {
+                const uint64_t due = sched.enabled() ? sched.wait(i - 1) : 0;
+                const Item item = make_item<Item>(i, (sample_every && i % sample_every == 0) ? (due ? due : clk.now()) : 0);
+                while (!q.enqueue(item)) {
+                    // busy-wait
+                    std::this_thread::yield();
+                }
+            }
+            late_ops = sched.late_ops();
+            max_lag_ns = sched.max_lag_ns();
+        });
 
-    double secs = std::chrono::duration<double>(end - start_time).count();
+        std::thread consumer([&]{
+            // wait for main to finish pinning
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t expected = 1;
+            Item v;
+            while (expected <= count) {
+                if (q.dequeue(v)) {
+                    if (item_value(v) != expected) {
+                        std::cerr << "Mismatch: got " << item_value(v) << " expected " << expected << '\n';
+                        std::exit(2);
+                    }
+                    if (const uint64_t tsc = item_tsc(v)) {
+                        // invariant TSC is synchronised across cores; guard against skew anyway
+                        const uint64_t now = clk.stop();
+                        hist.record(now > tsc ? clk.to_ns(now - tsc) : 0);
+                    }
+                    expected++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        // Pin threads before starting the workload
+        pin_thread_to_cpu(producer, prod_cpu);
+        pin_thread_to_cpu(consumer, cons_cpu);
+
+        // start timing and release threads
+        auto start_time = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+
+        producer.join();
+        consumer.join();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start_time).count();
+    };
+    const double secs = sample_every ? run(std::type_identity<StampedItem>{}) : run(std::type_identity<uint64_t>{});
     std::cout << "Transferred " << count << " items in " << secs << " seconds (" << (count / secs) << " ops/s)\n";
+    if (hist.count()) {
+        std::cout << "Queue latency (" << clk.source() << ", " << hist.count() << " samples): p50="
+                  << hist.percentile(50) << "ns p99=" << hist.percentile(99) << "ns p99.9=" << hist.percentile(99.9)
+                  << "ns max=" << hist.max() << "ns\n";
+    }
+    if (rate > 0.0) {
+        std::cout << "Open loop: target " << rate << " ops/s, late ops " << late_ops << ", max schedule lag "
+                  << max_lag_ns << "ns\n";
+    }
+
+    BenchReport report("spsc_demo");
+    report.option("items", count);
+    report.option("capacity", 1024);
+    report.option("producer_cpu", prod_cpu);
+    report.option("consumer_cpu", cons_cpu);
+    report.option("sample_every", sample_every);
+    report.option("item_bytes", sample_every ? sizeof(StampedItem) : sizeof(uint64_t));
+    report.option("load", rate > 0.0 ? "open" : "closed");
+    if (rate > 0.0) report.option("rate", rate);
+    report.clock_source(clk.source());
+    report.metric("spsc", "items", (double)count, "count", Better::None);
+    report.metric("spsc", "elapsed", secs, "s", Better::Lower);
+    report.metric("spsc", "throughput", count / secs, "ops/s", Better::Higher);
+    report.latency("spsc_latency", hist, 1.0, "ns");
+    if (rate > 0.0) {
+        report.metric("spsc", "late_ops", (double)late_ops, "count", Better::Lower);
+        report.metric("spsc", "max_schedule_lag", (double)max_lag_ns, "ns", Better::Lower);
+    }
+    std::cout.rdbuf(stdout_buf);
+    report.write(std::cout, format);
     return 0;
 }
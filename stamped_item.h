@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+// Queue element for the queue demos. With latency sampling on, every item
+// has room for its enqueue TSC (0 = unstamped). With --sample-every 0 the
+// demos move bare 8-byte values, so throughput is that of a plain uint64_t
+// queue.
+struct StampedItem {
+    uint64_t value;
+    uint64_t tsc;
+};
+
+inline uint64_t item_value(uint64_t v) { return v; }
+inline uint64_t item_value(const StampedItem& v) { return v.value; }
+inline uint64_t item_tsc(uint64_t) { return 0; }
+inline uint64_t item_tsc(const StampedItem& v) { return v.tsc; }
+
+template<typename Item>
+inline Item make_item(uint64_t value, uint64_t tsc)
+{
+    if constexpr (std::is_same_v<Item, uint64_t>) return value;
+    else return Item{value, tsc};
+}
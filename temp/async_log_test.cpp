@@ -0,0 +1,40 @@
+// Self-test for the async log ring: every argument slot keeps its type.
+#include "../async_log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main() {
+    FILE* out = std::tmpfile();
+    if (!out) { std::cerr << "async_log: tmpfile failed\n"; return 1; }
+    {
+        AsyncLog log(out);
+        auto& p = log.producer();
+        log.start();
+        p.log("{} {} {} {} {}", 1u, 2u, 3u, 4u, -5);
+        p.log("{} {} {} {} {}", -1, 2.5, 3u, int64_t(-4), 0.25);
+        p.log("{} {} {} {} {}", 1.5, -2, uint8_t(3), 4.0f, 5ull);
+        log.stop();
+    }
+
+    const char* want[] = {"1 2 3 4 -5", "-1 2.5 3 -4 0.25", "1.5 -2 3 4 5"};
+    std::rewind(out);
+    char line[512];
+    size_t n = 0;
+    while (std::fgets(line, sizeof(line), out)) {
+        line[std::strcspn(line, "\n")] = '\0';
+        const char* msg = std::strstr(line, "] ");
+        if (n >= 3 || !msg || std::strcmp(msg + 2, want[n]) != 0) {
+            std::cerr << "async_log format fail: '" << line << "'\n";
+            return 2;
+        }
+        ++n;
+    }
+    std::fclose(out);
+    if (n != 3) { std::cerr << "async_log: " << n << " lines\n"; return 3; }
+    std::cout << "async_log: PASS\n";
+    return 0;
+}
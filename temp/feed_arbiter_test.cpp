@@ -0,0 +1,124 @@
+// Self-test for the feed handler pieces in dpdk/md_feed.h that need no NIC:
+// message/trailer codecs, UDP payload extraction and A/B line arbitration.
+#include "../dpdk/md_feed.h"
+
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+struct Capture {
+    std::vector<uint64_t> delivered;
+    std::vector<std::pair<uint64_t, uint64_t>> gaps;
+
+    auto deliver() { return [this](const MdMessage& m, uint64_t) { delivered.push_back(m.seq); }; }
+    auto gap() { return [this](uint64_t first, uint64_t n) { gaps.emplace_back(first, n); }; }
+};
+
+static MdMessage msg(uint64_t seq) { return MdMessage{seq, uint32_t(seq % 7), 100, int64_t(seq) * 1000}; }
+
+static std::vector<uint64_t> range(uint64_t lo, uint64_t hi) // [lo, hi]
+{
+    std::vector<uint64_t> v;
+    for (uint64_t s = lo; s <= hi; ++s) v.push_back(s);
+    return v;
+}
+
+int main() {
+    // codecs: message round trip, send-stamp trailer, UDP payload bounds
+    uint8_t buf[2 * kMdMessageSize + kTxStampSize];
+    encode_md_message(buf, MdMessage{42, 7, 300, -12345});
+    encode_md_message(buf + kMdMessageSize, msg(43));
+    const MdMessage d = decode_md_message(buf);
+    if (d.seq != 42 || d.symbol != 7 || d.qty != 300 || d.price != -12345) { std::cerr << "md decode fail\n"; return 1; }
+    unsigned len = 2 * kMdMessageSize;
+    if (take_tx_stamp(buf, len) != 0 || len != 2 * kMdMessageSize) { std::cerr << "md unstamped fail\n"; return 2; }
+    put_tx_stamp(buf + 2 * kMdMessageSize, 0x1234567890ull);
+    len = sizeof(buf);
+    if (take_tx_stamp(buf, len) != 0x1234567890ull || len != 2 * kMdMessageSize) {
+        std::cerr << "md tx stamp fail\n"; return 3;
+    }
+
+    uint8_t frame[14 + 20 + 8 + kMdMessageSize] = {};
+    frame[14] = 0x45; // IPv4, 20-byte header
+    const unsigned udp_len = 8 + kMdMessageSize;
+    frame[14 + 20 + 4] = uint8_t(udp_len >> 8);
+    frame[14 + 20 + 5] = uint8_t(udp_len);
+    const uint8_t* payload = nullptr;
+    if (!udp_payload(frame, sizeof(frame), payload, len) || payload != frame + 42 || len != kMdMessageSize) {
+        std::cerr << "udp payload fail\n"; return 4;
+    }
+    if (udp_payload(frame, sizeof(frame) - 1, payload, len)) { std::cerr << "udp payload overrun fail\n"; return 5; }
+
+    // duplicates from the other line are dropped and counted against it
+    {
+        FeedArbiter arb(2, 1'000'000);
+        Capture c;
+        for (uint64_t s = 1; s <= 5; ++s) {
+            arb.on_message(0, msg(s), 100 * s, c.deliver(), c.gap());
+            arb.on_message(1, msg(s), 100 * s + 10, c.deliver(), c.gap());
+        }
+        arb.on_message(0, msg(5), 600, c.deliver(), c.gap()); // same-line repeat
+        if (c.delivered != range(1, 5) || arb.line(0).first != 5 || arb.line(1).duplicates != 5 ||
+            arb.line(0).lead.count() != 5 || arb.stats().stale != 1) {
+            std::cerr << "arb duplicate fail\n"; return 6;
+        }
+    }
+
+    // a loss on line A is filled by line B without a gap
+    {
+        FeedArbiter arb(2, 1'000'000);
+        Capture c;
+        arb.on_message(0, msg(1), 1, c.deliver(), c.gap());
+        arb.on_message(0, msg(3), 2, c.deliver(), c.gap());
+        arb.on_message(0, msg(4), 3, c.deliver(), c.gap());
+        if (!arb.gap_open() || c.delivered != range(1, 1)) { std::cerr << "arb gap hold fail\n"; return 7; }
+        arb.on_message(1, msg(2), 4, c.deliver(), c.gap());
+        if (arb.gap_open() || c.delivered != range(1, 4) || !c.gaps.empty() || arb.expected() != 5) {
+            std::cerr << "arb gap fill fail\n"; return 8;
+        }
+    }
+
+    // a gap nobody fills is given up after the timeout; late copies are stale
+    {
+        const TscClock& clk = TscClock::instance();
+        FeedArbiter arb(2, 1000);
+        Capture c;
+        const uint64_t t0 = 1'000'000;
+        arb.on_message(0, msg(10), t0, c.deliver(), c.gap());
+        arb.on_message(0, msg(13), t0, c.deliver(), c.gap());
+        arb.on_message(1, msg(14), t0, c.deliver(), c.gap());
+        arb.expire(t0 + clk.from_ns(500), c.deliver(), c.gap());
+        if (!arb.gap_open() || c.delivered.size() != 1) { std::cerr << "arb early expire fail\n"; return 9; }
+        arb.expire(t0 + clk.from_ns(5000), c.deliver(), c.gap());
+        const std::vector<std::pair<uint64_t, uint64_t>> want_gaps{{11, 2}};
+        if (arb.gap_open() || c.delivered != std::vector<uint64_t>{10, 13, 14} || c.gaps != want_gaps ||
+            arb.stats().gaps != 1 || arb.stats().missing != 2) {
+            std::cerr << "arb gap timeout fail\n"; return 10;
+        }
+        arb.on_message(1, msg(12), t0, c.deliver(), c.gap());
+        if (arb.stats().stale != 1 || c.delivered.size() != 3) { std::cerr << "arb late copy fail\n"; return 11; }
+    }
+
+    // a message kGapSlots ahead gives up the oldest hole; if the drain then
+    // reaches it, it is delivered, not buffered behind an empty gap
+    {
+        FeedArbiter arb(1, 1'000'000'000);
+        Capture c;
+        const uint64_t last = 2 + FeedArbiter::kGapSlots; // 1026
+        arb.on_message(0, msg(1), 1, c.deliver(), c.gap());
+        for (uint64_t s = 3; s < last; ++s) arb.on_message(0, msg(s), 1, c.deliver(), c.gap());
+        arb.on_message(0, msg(last), 2, c.deliver(), c.gap());
+        for (uint64_t s = last + 1; s <= last + 4; ++s) arb.on_message(0, msg(s), 3, c.deliver(), c.gap());
+        std::vector<uint64_t> want = range(1, 1);
+        for (uint64_t s : range(3, last + 4)) want.push_back(s);
+        const std::vector<std::pair<uint64_t, uint64_t>> want_gaps{{2, 1}};
+        if (arb.gap_open() || arb.expected() != last + 5 || c.delivered != want || c.gaps != want_gaps) {
+            std::cerr << "arb overflow fail: expected=" << arb.expected() << " delivered=" << c.delivered.size() << "\n";
+            return 12;
+        }
+    }
+
+    std::cout << "feed_arbiter: PASS\n";
+    return 0;
+}
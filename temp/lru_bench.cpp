@@ -1,64 +1,414 @@
-// Benchmark comparing Sharded LRU (mutex-based) vs two lock-free variants.
+// Benchmark suite comparing Sharded LRU (mutex-based) vs two lock-free variants.
 // This includes the implementations by including the .cpp files with LRU_BENCH
 // defined to prevent their standalone mains.
+//
+// Every worker replays a pre-generated stream of (op, key) pairs, so RNG and
+// distribution sampling never run inside the measured loop. Op/hit counters
+// live in per-thread cache-line aligned slots and are only summed after join.
+// Latency is sampled every --sample-every ops to keep clock reads off most ops.
+//
+// Usage:
+//   lru_bench [--cache sharded|lf_hp|lf_cas|all] [--threads N] [--duration S]
+//             [--ops N] [--keys N] [--capacity N] [--shards N]
+//             [--dist uniform|zipf|hotspot|scan] [--zipf-theta T]
+//             [--hot-keys F] [--hot-ops F] [--read-pct P] [--stream-len N]
+//             [--sample-every N] [--batch N] [--seed S] [--no-warmup]
+//             [--no-fill-on-miss] [--format text|csv|json]
+//
+// --batch N drives caches that provide get_many/put_many (the sharded LRU)
+// with N ops per call; latencies are then reported per batch call.
 
 #define LRU_BENCH
 #include "lru_cache.cpp"
 #include "lru_cache_lockfree.cpp"
+#include "../access_pattern.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
 using namespace std::chrono;
 
+struct BenchConfig {
+    std::string cache = "all";
+    int threads = 8;
+    int duration_s = 3;          // used when ops_per_thread == 0
+    uint64_t ops_per_thread = 0; // fixed op count per thread (reproducible)
+    int key_space = 10000;
+    size_t capacity = 16384;
+    size_t shards = 8;
+    std::string dist = "uniform";
+    double zipf_theta = 0.99;
+    double hot_keys = 0.2;       // hotspot: fraction of keys that are hot
+    double hot_ops = 0.8;        // hotspot: fraction of ops hitting hot keys
+    int read_pct = 90;
+    size_t stream_len = 1 << 20; // ops pre-generated per thread (replayed cyclically)
+    uint32_t sample_every = 64;
+    uint32_t batch = 1;          // >1: use get_many/put_many where the cache has them
+    uint64_t seed = 12345;
+    bool warmup = true;
+    bool fill_on_miss = true;
+    std::string format = "text";
+};
+
+struct Op {
+    int key;
+    bool read;
+};
+
+// Build one op stream per thread. Popular ranks are mapped through a seeded
+// permutation so hot keys land on random shards/buckets instead of 1..k.
+// Zipf ranks come from the shared generator in access_pattern.h.
+static std::vector<std::vector<Op>> make_streams(const BenchConfig &cfg) {
+    std::mt19937_64 perm_rng(cfg.seed);
+    std::vector<int> perm(cfg.key_space);
+    std::iota(perm.begin(), perm.end(), 1);
+    std::shuffle(perm.begin(), perm.end(), perm_rng);
+
+    std::optional<ZipfGenerator> zipf;
+    if (cfg.dist == "zipf") zipf.emplace(cfg.key_space, cfg.zipf_theta);
+    const int hot_n = std::max(1, int(cfg.hot_keys * cfg.key_space));
+
+    std::vector<std::vector<Op>> streams(cfg.threads);
+    for (int t = 0; t < cfg.threads; ++t) {
+        FastRng rng(cfg.seed + 1 + t);
+        const int cold_lo = std::min(hot_n, cfg.key_space - 1);
+        // scan: each thread sweeps the key space starting at its own offset
+        uint64_t scan_pos = uint64_t(t) * cfg.key_space / cfg.threads;
+
+        auto &s = streams[t];
+        s.resize(cfg.stream_len);
+        for (auto &op : s) {
+            int idx;
+            if (cfg.dist == "zipf") idx = int((*zipf)(rng));
+            else if (cfg.dist == "hotspot")
+                idx = rng.unit() < cfg.hot_ops ? int(rng.below(hot_n)) : cold_lo + int(rng.below(cfg.key_space - cold_lo));
+            else if (cfg.dist == "scan") idx = int(scan_pos++ % cfg.key_space);
+            else idx = int(rng.below(cfg.key_space));
+            op.key = cfg.dist == "scan" ? idx + 1 : perm[idx];
+            op.read = int(rng.below(100)) < cfg.read_pct;
+        }
+    }
+    return streams;
+}
+
+struct alignas(64) ThreadStats {
+    uint64_t gets = 0;
+    uint64_t hits = 0;
+    uint64_t puts = 0;
+    std::vector<uint32_t> get_lat_ns;
+    std::vector<uint32_t> put_lat_ns;
+};
+
+struct LatencySummary {
+    size_t samples = 0;
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+struct BenchResult {
+    std::string cache;
+    uint64_t gets = 0, hits = 0, puts = 0;
+    double secs = 0;
+    LatencySummary get_lat, put_lat;
+
+    uint64_t ops() const { return gets + puts; }
+    double ops_per_s() const { return secs > 0 ? double(ops()) / secs : 0.0; }
+    double hit_rate() const { return gets ? double(hits) / double(gets) : 0.0; }
+};
+
+static LatencySummary summarize(std::vector<uint32_t> &v) {
+    LatencySummary s;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    auto at = [&](double p) { return double(v[size_t(p / 100.0 * double(v.size() - 1))]); };
+    s.samples = v.size();
+    s.p50 = at(50); s.p90 = at(90); s.p99 = at(99); s.p999 = at(99.9);
+    s.max = double(v.back());
+    return s;
+}
+
 template<typename Cache>
-double run_workload(Cache &cache, int threads, int duration_s, int key_space) {
+BenchResult run_workload(const std::string &name, Cache &cache, const BenchConfig &cfg,
+                         const std::vector<std::vector<Op>> &streams) {
+    if (cfg.warmup) {
+        for (int k = 1; k <= cfg.key_space; ++k) cache.put(k, k);
+    }
+
+    // per-thread sample cap keeps memory bounded on long runs
+    const size_t max_samples = size_t(1) << 20;
+    std::vector<ThreadStats> stats(cfg.threads);
+    std::atomic<int> ready{0};
+    std::atomic<bool> start{false};
     std::atomic<bool> stop{false};
-    std::atomic<uint64_t> ops{0};
-    auto worker = [&](int id){
-        std::mt19937_64 rng(id + 12345);
-        std::uniform_int_distribution<int> dist(1, key_space);
-        while (!stop.load(std::memory_order_acquire)) {
-            int k = dist(rng);
-            cache.put(k, k);
-            auto v = cache.get(k);
-            (void)v;
-            ops.fetch_add(1, std::memory_order_relaxed);
+
+    auto worker = [&](int id) {
+        ThreadStats &st = stats[id];
+        st.get_lat_ns.reserve(max_samples);
+        st.put_lat_ns.reserve(max_samples);
+        const std::vector<Op> &ops = streams[id];
+        const size_t n = ops.size();
+        uint64_t gets = 0, hits = 0, puts = 0;
+
+        ready.fetch_add(1, std::memory_order_acq_rel);
+        while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+
+        auto record = [&](std::vector<uint32_t> &v, steady_clock::time_point t0) {
+            if (v.size() < max_samples)
+                v.push_back(uint32_t(duration_cast<nanoseconds>(steady_clock::now() - t0).count()));
+        };
+
+        if constexpr (requires { cache.get_many(std::span<const int>{}, std::span<std::optional<int>>{}); }) {
+            if (cfg.batch > 1) {
+                // batched path: split each window of the stream into reads and
+                // writes and issue them through get_many/put_many
+                std::vector<int> rkeys, wkeys, miss;
+                std::vector<std::optional<int>> got(cfg.batch);
+                for (uint64_t i = 0;; i += cfg.batch) {
+                    if (cfg.ops_per_thread ? i >= cfg.ops_per_thread : stop.load(std::memory_order_relaxed)) break;
+                    rkeys.clear(); wkeys.clear();
+                    for (uint32_t b = 0; b < cfg.batch; ++b) {
+                        const Op op = ops[(i + b) % n];
+                        (op.read ? rkeys : wkeys).push_back(op.key);
+                    }
+                    const bool sample = ((i / cfg.batch) % cfg.sample_every) == 0;
+                    steady_clock::time_point t0;
+                    if (!rkeys.empty()) {
+                        if (sample) t0 = steady_clock::now();
+                        cache.get_many(rkeys, got);
+                        if (sample) record(st.get_lat_ns, t0);
+                        gets += rkeys.size();
+                        miss.clear();
+                        for (size_t j = 0; j < rkeys.size(); ++j) {
+                            if (got[j]) ++hits;
+                            else miss.push_back(rkeys[j]);
+                        }
+                        // the fill is a put: timed as one, not as part of the get
+                        if (cfg.fill_on_miss && !miss.empty()) {
+                            if (sample) t0 = steady_clock::now();
+                            puts += miss.size();
+                            cache.put_many(miss, miss);
+                            if (sample) record(st.put_lat_ns, t0);
+                        }
+                    }
+                    if (!wkeys.empty()) {
+                        if (sample) t0 = steady_clock::now();
+                        puts += wkeys.size();
+                        cache.put_many(wkeys, wkeys);
+                        if (sample) record(st.put_lat_ns, t0);
+                    }
+                }
+                st.gets = gets; st.hits = hits; st.puts = puts;
+                return;
+            }
         }
+
+        for (uint64_t i = 0;; ++i) {
+            if (cfg.ops_per_thread ? i >= cfg.ops_per_thread
+                                   : ((i & 255) == 0 && stop.load(std::memory_order_relaxed))) break;
+            const Op op = ops[i % n];
+            const bool sample = (i % cfg.sample_every) == 0;
+            steady_clock::time_point t0;
+            if (sample) t0 = steady_clock::now();
+            if (op.read) {
+                ++gets;
+                auto v = cache.get(op.key);
+                if (sample) record(st.get_lat_ns, t0);
+                if (v) {
+                    ++hits;
+                } else if (cfg.fill_on_miss) {
+                    // the fill is a put: timed as one, not as part of the get
+                    if (sample) t0 = steady_clock::now();
+                    ++puts;
+                    cache.put(op.key, op.key);
+                    if (sample) record(st.put_lat_ns, t0);
+                }
+            } else {
+                ++puts;
+                cache.put(op.key, op.key);
+                if (sample) record(st.put_lat_ns, t0);
+            }
+        }
+        st.gets = gets; st.hits = hits; st.puts = puts;
     };
 
     std::vector<std::thread> ts;
-    for (int i = 0; i < threads; ++i) ts.emplace_back(worker, i);
-    std::this_thread::sleep_for(std::chrono::seconds(duration_s));
-    stop.store(true, std::memory_order_release);
+    for (int i = 0; i < cfg.threads; ++i) ts.emplace_back(worker, i);
+    while (ready.load(std::memory_order_acquire) < cfg.threads) std::this_thread::yield();
+
+    auto t0 = steady_clock::now();
+    start.store(true, std::memory_order_release);
+    if (!cfg.ops_per_thread) {
+        std::this_thread::sleep_for(seconds(cfg.duration_s));
+        stop.store(true, std::memory_order_relaxed);
+    }
     for (auto &t : ts) t.join();
-    return double(ops.load()) / duration_s;
+    auto t1 = steady_clock::now();
+
+    BenchResult r;
+    r.cache = name;
+    r.secs = duration<double>(t1 - t0).count();
+    std::vector<uint32_t> get_all, put_all;
+    for (auto &st : stats) {
+        r.gets += st.gets; r.hits += st.hits; r.puts += st.puts;
+        get_all.insert(get_all.end(), st.get_lat_ns.begin(), st.get_lat_ns.end());
+        put_all.insert(put_all.end(), st.put_lat_ns.begin(), st.put_lat_ns.end());
+    }
+    r.get_lat = summarize(get_all);
+    r.put_lat = summarize(put_all);
+    return r;
 }
 
-int main() {
-    const int threads = 8;
-    const int duration_s = 3; // run each test 3s
-    const int key_space = 10000;
+static void print_text(const BenchConfig &cfg, const std::vector<BenchResult> &results) {
+    std::cout << "Benchmark: " << cfg.threads << " threads, dist=" << cfg.dist
+              << ", read=" << cfg.read_pct << "%, key space=" << cfg.key_space
+              << ", capacity=" << cfg.capacity << ", batch=" << cfg.batch << "\n";
+    for (const auto &r : results) {
+        std::cout << r.cache << ": " << std::fixed << std::setprecision(0) << r.ops_per_s() << " ops/s"
+                  << std::setprecision(2) << ", hit rate " << 100.0 * r.hit_rate() << "%\n";
+        auto line = [](const char *what, const LatencySummary &l) {
+            std::cout << "  " << what << " latency (ns, " << l.samples << " samples): p50=" << l.p50
+                      << " p90=" << l.p90 << " p99=" << l.p99 << " p99.9=" << l.p999 << " max=" << l.max << "\n";
+        };
+        line("get", r.get_lat);
+        line("put", r.put_lat);
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+static void print_csv(const BenchConfig &cfg, const std::vector<BenchResult> &results) {
+    std::cout << "cache,dist,threads,read_pct,keys,capacity,batch,seed,secs,ops,ops_per_s,hit_rate";
+    for (const char *op : {"get", "put"})
+        for (const char *p : {"p50", "p90", "p99", "p999", "max"}) std::cout << ',' << op << '_' << p << "_ns";
+    std::cout << "\n";
+    for (const auto &r : results) {
+        std::cout << r.cache << ',' << cfg.dist << ',' << cfg.threads << ',' << cfg.read_pct << ','
+                  << cfg.key_space << ',' << cfg.capacity << ',' << cfg.batch << ',' << cfg.seed << ',' << r.secs << ','
+                  << r.ops() << ',' << r.ops_per_s() << ',' << r.hit_rate();
+        for (const auto *l : {&r.get_lat, &r.put_lat})
+            std::cout << ',' << l->p50 << ',' << l->p90 << ',' << l->p99 << ',' << l->p999 << ',' << l->max;
+        std::cout << "\n";
+    }
+}
 
-    std::cout << "Benchmark: " << threads << " threads, " << duration_s << "s each, key space=" << key_space << "\n";
+static void print_json(const BenchConfig &cfg, const std::vector<BenchResult> &results) {
+    std::cout << "{\"benchmark\":\"lru_bench\",\"config\":{"
+              << "\"threads\":" << cfg.threads << ",\"dist\":\"" << cfg.dist << "\""
+              << ",\"zipf_theta\":" << cfg.zipf_theta << ",\"read_pct\":" << cfg.read_pct
+              << ",\"keys\":" << cfg.key_space << ",\"capacity\":" << cfg.capacity
+              << ",\"shards\":" << cfg.shards << ",\"seed\":" << cfg.seed
+              << ",\"sample_every\":" << cfg.sample_every << ",\"batch\":" << cfg.batch << "},\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto &r = results[i];
+        auto lat = [](const LatencySummary &l) {
+            std::ostringstream os;
+            os << "{\"samples\":" << l.samples << ",\"p50_ns\":" << l.p50 << ",\"p90_ns\":" << l.p90
+               << ",\"p99_ns\":" << l.p99 << ",\"p999_ns\":" << l.p999 << ",\"max_ns\":" << l.max << "}";
+            return os.str();
+        };
+        std::cout << (i ? "," : "") << "{\"cache\":\"" << r.cache << "\",\"secs\":" << r.secs
+                  << ",\"ops\":" << r.ops() << ",\"gets\":" << r.gets << ",\"puts\":" << r.puts
+                  << ",\"ops_per_s\":" << r.ops_per_s() << ",\"hit_rate\":" << r.hit_rate()
+                  << ",\"get\":" << lat(r.get_lat) << ",\"put\":" << lat(r.put_lat) << "}";
+    }
+    std::cout << "]}\n";
+}
 
-    // Sharded LRU
-    ShardedLRUCache<int,int> sharded(16384, 8);
-    double rate_sharded = run_workload(sharded, threads, duration_s, key_space);
-    std::cout << "Sharded LRU throughput: " << rate_sharded << " ops/s\n";
+static void usage(const char *prog) {
+    std::cout << "Usage: " << prog << " [--cache sharded|lf_hp|lf_cas|all] [--threads N] [--duration S]"
+              << " [--ops N] [--keys N] [--capacity N] [--shards N] [--dist uniform|zipf|hotspot|scan]"
+              << " [--zipf-theta T] [--hot-keys F] [--hot-ops F] [--read-pct P] [--stream-len N]"
+              << " [--sample-every N] [--batch N] [--seed S] [--no-warmup] [--no-fill-on-miss] [--format text|csv|json]\n";
+}
+
+int main(int argc, char **argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string s(argv[i]);
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        try {
+            if (s == "--cache") cfg.cache = next();
+            else if (s == "--threads") cfg.threads = std::stoi(next());
+            else if (s == "--duration") cfg.duration_s = std::stoi(next());
+            else if (s == "--ops") cfg.ops_per_thread = std::stoull(next());
+            else if (s == "--keys") cfg.key_space = std::stoi(next());
+            else if (s == "--capacity") cfg.capacity = std::stoull(next());
+            else if (s == "--shards") cfg.shards = std::stoull(next());
+            else if (s == "--dist") cfg.dist = next();
+            else if (s == "--zipf-theta") cfg.zipf_theta = std::stod(next());
+            else if (s == "--hot-keys") cfg.hot_keys = std::stod(next());
+            else if (s == "--hot-ops") cfg.hot_ops = std::stod(next());
+            else if (s == "--read-pct") cfg.read_pct = std::stoi(next());
+            else if (s == "--stream-len") cfg.stream_len = std::stoull(next());
+            else if (s == "--sample-every") cfg.sample_every = std::max(1, std::stoi(next()));
+            else if (s == "--batch") cfg.batch = std::max(1, std::stoi(next()));
+            else if (s == "--seed") cfg.seed = std::stoull(next());
+            else if (s == "--no-warmup") cfg.warmup = false;
+            else if (s == "--no-fill-on-miss") cfg.fill_on_miss = false;
+            else if (s == "--format") cfg.format = next();
+            else if (s == "-h" || s == "--help") {
+                usage(argv[0]);
+                return 0;
+            } else {
+                std::cerr << "unknown option " << s << " (see --help)\n";
+                return 1;
+            }
+        } catch (const std::logic_error &) { // std::invalid_argument / std::out_of_range from stoi & co.
+            std::cerr << "invalid value for " << s << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!(cfg.hot_keys >= 0.0 && cfg.hot_keys <= 1.0) || !(cfg.hot_ops >= 0.0 && cfg.hot_ops <= 1.0)) {
+        std::cerr << "--hot-keys and --hot-ops must be fractions in [0,1]\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.cache != "all" && cfg.cache != "sharded" && cfg.cache != "lf_hp" && cfg.cache != "lf_cas") {
+        std::cerr << "unknown --cache " << cfg.cache << "\n";
+        return 1;
+    }
+    if (cfg.format != "text" && cfg.format != "csv" && cfg.format != "json") {
+        std::cerr << "unknown --format " << cfg.format << "\n";
+        return 1;
+    }
+    if (cfg.dist != "uniform" && cfg.dist != "zipf" && cfg.dist != "hotspot" && cfg.dist != "scan") {
+        std::cerr << "unknown --dist " << cfg.dist << "\n";
+        return 1;
+    }
+    cfg.threads = std::max(1, cfg.threads);
+    cfg.key_space = std::max(1, cfg.key_space);
+    cfg.read_pct = std::clamp(cfg.read_pct, 0, 100);
+    cfg.stream_len = std::max<size_t>(1, cfg.stream_len);
 
-    // Lock-free Hazard Pointers
-    LockFreeLRU_HazardPointers<int,int> lf_hp(128, 16384);
-    double rate_lf_hp = run_workload(lf_hp, threads, duration_s, key_space);
-    std::cout << "LockFree (hazard ptrs) throughput: " << rate_lf_hp << " ops/s\n";
+    const auto streams = make_streams(cfg);
+    auto want = [&](const char *name) { return cfg.cache == "all" || cfg.cache == name; };
 
-    // Lock-free per-node CAS (shared_ptr)
-    LockFreeLRU_PerNodeCAS<int,int> lf_cas(128, 16384);
-    double rate_lf_cas = run_workload(lf_cas, threads, duration_s, key_space);
-    std::cout << "LockFree (shared_ptr CAS) throughput: " << rate_lf_cas << " ops/s\n";
+    std::vector<BenchResult> results;
+    if (want("sharded")) {
+        ShardedLRUCache<int,int> sharded(cfg.capacity, cfg.shards);
+        results.push_back(run_workload("sharded", sharded, cfg, streams));
+    }
+    if (want("lf_hp")) {
+        LockFreeLRU_HazardPointers<int,int> lf_hp(128, cfg.capacity);
+        results.push_back(run_workload("lf_hp", lf_hp, cfg, streams));
+    }
+    if (want("lf_cas")) {
+        LockFreeLRU_PerNodeCAS<int,int> lf_cas(128, cfg.capacity);
+        results.push_back(run_workload("lf_cas", lf_cas, cfg, streams));
+    }
 
+    if (cfg.format == "csv") print_csv(cfg, results);
+    else if (cfg.format == "json") print_json(cfg, results);
+    else print_text(cfg, results);
     return 0;
 }
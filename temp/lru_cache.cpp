@@ -3,72 +3,513 @@
 // and behaves like a lock-free design at the global level because accesses to
 // different shards don't block each other.
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <list>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../tsc_clock.h"
+
+// Transparent hash for std::string keys: lets string_view / const char*
+// lookups probe the map without materializing a temporary std::string.
+// std::hash<string_view> and std::hash<string> agree, so mixing is safe.
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+// Short symbol stored inline in 16 bytes (zero padded), compared with one
+// SSE2 compare instead of a length check + memcmp. Construction from a
+// string_view never allocates; symbols longer than 16 bytes are rejected.
+struct alignas(16) InlineSymbol {
+    char data[16] = {};
 
-template<typename K, typename V>
+    InlineSymbol() = default;
+    InlineSymbol(std::string_view s) {
+        if (s.size() > sizeof(data)) throw std::length_error("InlineSymbol: symbol longer than 16 bytes");
+        std::memcpy(data, s.data(), s.size());
+    }
+
+    std::string_view view() const { return std::string_view(data, strnlen(data, sizeof(data))); }
+
+    friend bool operator==(const InlineSymbol& a, const InlineSymbol& b) noexcept {
+#if defined(__SSE2__)
+        __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(a.data));
+        __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(b.data));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xFFFF;
+#else
+        return std::memcmp(a.data, b.data, sizeof(a.data)) == 0;
+#endif
+    }
+};
+
+template<>
+struct std::hash<InlineSymbol> {
+    size_t operator()(const InlineSymbol& s) const noexcept {
+        uint64_t lo, hi;
+        std::memcpy(&lo, s.data, 8);
+        std::memcpy(&hi, s.data + 8, 8);
+        uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+        return size_t(h ^ (h >> 31));
+    }
+};
+
+// std::string keys get transparent hashing/equality by default; everything
+// else uses the standard function objects.
+template<typename K>
+using DefaultHash = std::conditional_t<std::is_same_v<K, std::string>, StringHash, std::hash<K>>;
+template<typename K>
+using DefaultKeyEqual = std::conditional_t<std::is_same_v<K, std::string>, std::equal_to<>, std::equal_to<K>>;
+
+// Q can be used to look up a K without conversion (heterogeneous lookup).
+template<typename Q, typename K, typename Hash, typename KeyEqual>
+concept TransparentKey = !std::is_same_v<std::remove_cvref_t<Q>, K>
+    && requires { typename Hash::is_transparent; typename KeyEqual::is_transparent; }
+    && std::constructible_from<K, const Q&>;
+
+// Clock sources for TTL bookkeeping. A clock is any type with a static
+// `uint64_t now_ns()` on a monotonic timeline (tests plug in a manual one).
+struct SteadyClock {
+    static uint64_t now_ns() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+// Default TTL clock: an unfenced rdtsc scaled by the process-wide TscClock
+// calibration (20ms busy-wait on first use). Reads may be reordered by a few
+// ns, which does not matter for expiry checks. Without an invariant TSC it
+// falls back to steady_clock, like TscClock itself.
+struct CoarseTscClock {
+    static uint64_t now_ns() {
+        const TscClock& c = TscClock::instance();
+        return c.to_ns(c.now());
+    }
+};
+
+// Options for get_or_load. A negative ttl means "use the cache default".
+// With refresh_ahead > 0, a hit whose remaining TTL is within that window
+// returns the cached value immediately and queues a reload on the shard's
+// refresh thread.
+struct LoadOptions {
+    std::chrono::nanoseconds ttl{-1};
+    std::chrono::nanoseconds refresh_ahead{0};
+};
+
+template<typename K, typename V, typename Hash = DefaultHash<K>, typename KeyEqual = DefaultKeyEqual<K>,
+         typename Clock = CoarseTscClock>
 class LRUCacheShard {
 public:
-    explicit LRUCacheShard(size_t cap) : cap_(cap) {
+    // default_ttl == 0 means entries never expire unless put with an explicit TTL.
+    // wheel_tick is the granularity of the expiry timer wheel.
+    explicit LRUCacheShard(size_t cap, std::chrono::nanoseconds default_ttl = std::chrono::nanoseconds(0),
+                           std::chrono::nanoseconds wheel_tick = std::chrono::milliseconds(10))
+        : cap_(cap), default_ttl_ns_(uint64_t(default_ttl.count())),
+          tick_ns_(std::max<uint64_t>(1, uint64_t(wheel_tick.count()))), wheel_(kWheelSlots) {
         if (cap_ == 0) cap_ = 1;
+        wheel_tick_ = Clock::now_ns() / tick_ns_;
     }
 
-    std::optional<V> get(const K& k) {
+    // queued refreshes reference the shard; run them before it goes away
+    ~LRUCacheShard() { refresher_.stop(); }
+
+    std::optional<V> get(const K& k) { return get_impl(k); }
+
+    template<typename Q> requires TransparentKey<Q, K, Hash, KeyEqual>
+    std::optional<V> get(const Q& k) { return get_impl(k); }
+
+    void put(const K& k, V v) {
+        std::unique_lock lock(m_);
+        put_locked(k, std::move(v), default_ttl_ns_);
+    }
+
+    // A K is only constructed from q when the key is not already present.
+    template<typename Q> requires TransparentKey<Q, K, Hash, KeyEqual>
+    void put(const Q& q, V v) {
+        std::unique_lock lock(m_);
+        put_locked(q, std::move(v), default_ttl_ns_);
+    }
+
+    // Per-entry TTL; ttl == 0 stores the entry without expiry.
+    template<typename Q> requires std::same_as<Q, K> || TransparentKey<Q, K, Hash, KeyEqual>
+    void put(const Q& q, V v, std::chrono::nanoseconds ttl) {
+        std::unique_lock lock(m_);
+        put_locked(q, std::move(v), uint64_t(std::max<int64_t>(0, ttl.count())));
+    }
+
+    // Single-flight read-through. On a miss the first caller registers an
+    // in-flight future for the key and runs loader(k) outside the lock;
+    // concurrent missers for the same key wait on that future instead of
+    // calling the loader again. Loader exceptions propagate to every waiter
+    // and nothing is cached. A put() of the key while the loader runs wins:
+    // the loaded value is still returned but not cached over it.
+    //
+    // Refresh-ahead copies the loader and runs the copy later on the shard's
+    // refresh thread, after this call has returned. A loader used with
+    // refresh_ahead must therefore own its state (capture by value or
+    // shared_ptr), never reference the caller's stack frame.
+    template<typename Loader>
+    V get_or_load(const K& k, Loader&& loader, LoadOptions opts = {}) {
+        const uint64_t ttl_ns = opts.ttl.count() < 0 ? default_ttl_ns_ : uint64_t(opts.ttl.count());
+        std::optional<std::promise<V>> promise; // only a miss that runs the loader needs one
+        std::shared_future<V> fut;
+        {
+            std::unique_lock lock(m_);
+            auto it = map_.find(k);
+            if (it != map_.end()) {
+                auto item = it->second;
+                const uint64_t now = item->expires_ns ? Clock::now_ns() : 0;
+                if (!item->expires_ns || item->expires_ns > now) {
+                    items_.splice(items_.begin(), items_, item);
+                    V v = item->value;
+                    if constexpr (std::copy_constructible<std::decay_t<Loader>>) {
+                        if (opts.refresh_ahead.count() > 0 && item->expires_ns &&
+                            item->expires_ns - now <= uint64_t(opts.refresh_ahead.count()) &&
+                            inflight_.find(k) == inflight_.end()) {
+                            start_refresh_locked(k, loader, ttl_ns);
+                        }
+                    }
+                    return v;
+                }
+                erase_locked(it);
+            }
+            auto fit = inflight_.find(k);
+            if (fit != inflight_.end()) {
+                fut = fit->second.result;
+            } else {
+                promise.emplace();
+                inflight_.emplace(k, Inflight{promise->get_future().share()});
+            }
+        }
+        if (fut.valid()) return fut.get();
+        return load_and_publish(k, loader, *promise, ttl_ns);
+    }
+
+    // Batched variants used by ShardedLRUCache::get_many/put_many. `idx` lists
+    // the positions in `keys` (and `out`/`vals`) that belong to this shard; the
+    // whole group is served under a single lock acquisition. (No bucket
+    // prefetch: std::unordered_map only exposes buckets through a lookup that
+    // hashes and loads them, so touching keys ahead did not overlap misses.)
+    void get_batch(std::span<const K> keys, std::span<const uint32_t> idx, std::span<std::optional<V>> out) {
+        std::unique_lock lock(m_);
+        const size_t n = idx.size();
+        uint64_t now = 0; // read lazily, once per batch
+        for (size_t j = 0; j < n; ++j) {
+            const uint32_t i = idx[j];
+            auto it = map_.find(keys[i]);
+            if (it == map_.end()) { out[i] = std::nullopt; continue; }
+            auto item = it->second;
+            if (item->expires_ns) {
+                if (!now) now = Clock::now_ns();
+                if (item->expires_ns <= now) { erase_locked(it); out[i] = std::nullopt; continue; }
+            }
+            items_.splice(items_.begin(), items_, item);
+            out[i] = item->value;
+        }
+    }
+
+    void put_batch(std::span<const K> keys, std::span<const V> vals, std::span<const uint32_t> idx) {
+        std::unique_lock lock(m_);
+        for (const uint32_t i : idx) put_locked(keys[i], vals[i], default_ttl_ns_);
+    }
+
+    // Reclaim expired entries from wheel slots whose tick has fully elapsed,
+    // examining at most `budget` wheel records per call so the shard lock is
+    // only held for a bounded slice. Returns the number of entries removed.
+    // Progress (slot and position) is kept between calls.
+    size_t sweep_expired(size_t budget) {
+        std::unique_lock lock(m_);
+        const uint64_t now = Clock::now_ns();
+        const uint64_t target = now / tick_ns_;
+        // fell more than a full rotation behind: one pass over every slot suffices
+        if (target - wheel_tick_ > kWheelSlots) { wheel_tick_ = target - kWheelSlots; wheel_pos_ = 0; }
+        size_t reclaimed = 0;
+        while (budget && wheel_tick_ < target) {
+            auto& slot = wheel_[wheel_tick_ & (kWheelSlots - 1)];
+            while (budget && wheel_pos_ < slot.size()) {
+                --budget;
+                const WheelRecord& r = slot[wheel_pos_];
+                if (r.expires_ns > now) { ++wheel_pos_; continue; } // due in a later rotation
+                // erasing the entry also removes its record from this slot
+                erase_locked(map_.find(r.item->key));
+                ++reclaimed;
+            }
+            if (wheel_pos_ < slot.size()) break; // budget exhausted mid-slot
+            ++wheel_tick_;
+            wheel_pos_ = 0;
+        }
+        return reclaimed;
+    }
+
+    // Includes expired entries that have not been reclaimed yet.
+    size_t size() const {
+        std::shared_lock lock(m_);
+        return map_.size();
+    }
+
+    // Timer wheel records: one per entry that carries a TTL, so <= size().
+    size_t wheel_records() const {
+        std::shared_lock lock(m_);
+        size_t n = 0;
+        for (const auto& slot : wheel_) n += slot.size();
+        return n;
+    }
+
+private:
+    static constexpr size_t kWheelSlots = 256; // power of two
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+    static constexpr size_t kMaxQueuedRefreshes = 64;
+
+    struct Entry {
+        K key;
+        V value;
+        uint64_t expires_ns; // 0: no expiry
+        uint32_t wheel_slot = kNoSlot; // where this entry's wheel record sits
+        uint32_t wheel_pos = 0;
+    };
+    using ItemIter = typename std::list<Entry>::iterator;
+    using MapIter = typename std::unordered_map<K, ItemIter, Hash, KeyEqual>::iterator;
+
+    // Timer wheel record. An entry with a TTL owns exactly one; re-puts move
+    // it and eviction/erase remove it, so the wheel never holds more records
+    // than the shard holds entries. The expiry is copied in so records due in
+    // a later rotation are skipped without touching the entry.
+    struct WheelRecord {
+        ItemIter item;
+        uint64_t expires_ns;
+    };
+
+    // A load in flight. superseded is set when the key is put() meanwhile,
+    // so the older loaded value is not cached over the newer one.
+    struct Inflight {
+        std::shared_future<V> result;
+        bool superseded = false;
+    };
+
+    // One refresh-ahead thread per shard, started on first use. The queue
+    // is bounded: when it is full the refresh is skipped and the entry is
+    // reloaded by get_or_load once it expires.
+    class RefreshWorker {
+    public:
+        bool submit(std::function<void()> task) {
+            std::lock_guard lock(m_);
+            if (stop_ || queue_.size() >= kMaxQueuedRefreshes) return false;
+            if (!thread_.joinable()) thread_ = std::thread([this] { run(); });
+            queue_.push_back(std::move(task));
+            cv_.notify_one();
+            return true;
+        }
+
+        // Runs whatever is still queued, then joins.
+        void stop() {
+            {
+                std::lock_guard lock(m_);
+                stop_ = true;
+            }
+            cv_.notify_one();
+            if (thread_.joinable()) thread_.join();
+        }
+
+    private:
+        void run() {
+            std::unique_lock lock(m_);
+            for (;;) {
+                cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                auto task = std::move(queue_.front());
+                queue_.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+
+        std::mutex m_;
+        std::condition_variable cv_;
+        std::deque<std::function<void()>> queue_;
+        std::thread thread_;
+        bool stop_ = false;
+    };
+
+    template<typename Q>
+    std::optional<V> get_impl(const Q& k) {
         std::unique_lock lock(m_);
         auto it = map_.find(k);
         if (it == map_.end()) return std::nullopt;
-        items_.splice(items_.begin(), items_, it->second);
-        return it->second->second;
+        auto item = it->second;
+        // lazy expiry: the clock is only read for entries that carry a TTL
+        if (item->expires_ns && item->expires_ns <= Clock::now_ns()) {
+            erase_locked(it);
+            return std::nullopt;
+        }
+        items_.splice(items_.begin(), items_, item);
+        return item->value;
     }
 
-    void put(const K& k, V v) {
-        std::unique_lock lock(m_);
+    // A caller's write: also marks a load of the same key in flight as stale.
+    template<typename Q>
+    void put_locked(const Q& k, V v, uint64_t ttl_ns) {
+        if (!inflight_.empty()) {
+            auto fit = inflight_.find(k);
+            if (fit != inflight_.end()) fit->second.superseded = true;
+        }
+        store_locked(k, std::move(v), ttl_ns);
+    }
+
+    template<typename Q>
+    void store_locked(const Q& k, V v, uint64_t ttl_ns) {
+        const uint64_t expires = ttl_ns ? Clock::now_ns() + ttl_ns : 0;
         auto it = map_.find(k);
         if (it != map_.end()) {
-            it->second->second = std::move(v);
-            items_.splice(items_.begin(), items_, it->second);
+            auto item = it->second;
+            item->value = std::move(v);
+            items_.splice(items_.begin(), items_, item);
+            if (item->expires_ns != expires) {
+                unschedule(*item);
+                item->expires_ns = expires;
+                if (expires) schedule(item);
+            }
             return;
         }
-        items_.emplace_front(k, std::move(v));
-        map_[k] = items_.begin();
+        items_.push_front(Entry{K(k), std::move(v), expires});
+        map_.emplace(items_.front().key, items_.begin());
+        if (expires) schedule(items_.begin());
         if (map_.size() > cap_) {
             auto last = items_.end(); --last;
-            map_.erase(last->first);
+            unschedule(*last);
+            map_.erase(last->key);
             items_.pop_back();
         }
     }
 
-    size_t size() const {
-        std::shared_lock lock(m_);
-        return map_.size();
+    // Run the loader for a key this thread registered in inflight_, cache the
+    // result (unless a put() got there first) and wake the waiters.
+    template<typename Loader>
+    V load_and_publish(const K& k, Loader& loader, std::promise<V>& promise, uint64_t ttl_ns) {
+        try {
+            V v = loader(k);
+            {
+                std::unique_lock lock(m_);
+                auto fit = inflight_.find(k);
+                if (fit == inflight_.end() || !fit->second.superseded) store_locked(k, v, ttl_ns);
+                if (fit != inflight_.end()) inflight_.erase(fit);
+            }
+            promise.set_value(v);
+            return v;
+        } catch (...) {
+            {
+                std::unique_lock lock(m_);
+                inflight_.erase(k);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    // The task cannot publish before the inflight_ entry exists: publishing
+    // takes m_, which the caller holds.
+    template<typename Loader>
+    void start_refresh_locked(const K& k, const Loader& loader, uint64_t ttl_ns) {
+        auto promise = std::make_shared<std::promise<V>>();
+        auto task = [this, k, loader, promise, ttl_ns]() mutable {
+            try { load_and_publish(k, loader, *promise, ttl_ns); } catch (...) {}
+        };
+        if (!refresher_.submit(std::move(task))) return;
+        inflight_.emplace(k, Inflight{promise->get_future().share()});
+    }
+
+    void erase_locked(MapIter it) {
+        auto item = it->second;
+        unschedule(*item);
+        map_.erase(it);
+        items_.erase(item);
+    }
+
+    void schedule(ItemIter item) {
+        // records that are already due go into the slot currently being swept
+        const uint64_t tick = std::max(item->expires_ns / tick_ns_, wheel_tick_);
+        auto& slot = wheel_[tick & (kWheelSlots - 1)];
+        item->wheel_slot = uint32_t(tick & (kWheelSlots - 1));
+        item->wheel_pos = uint32_t(slot.size());
+        slot.push_back(WheelRecord{item, item->expires_ns});
+    }
+
+    // O(1) removal: the hole is filled from the back of the slot. In the slot
+    // being swept, records before wheel_pos_ have been examined already; a
+    // hole there is filled from the examined part so no unexamined record is
+    // moved behind the sweep position.
+    void unschedule(Entry& e) {
+        if (e.wheel_slot == kNoSlot) return;
+        auto& slot = wheel_[e.wheel_slot];
+        uint32_t hole = e.wheel_pos;
+        if (e.wheel_slot == (wheel_tick_ & (kWheelSlots - 1)) && hole < wheel_pos_) {
+            --wheel_pos_;
+            move_record(slot, uint32_t(wheel_pos_), hole);
+            hole = uint32_t(wheel_pos_);
+        }
+        move_record(slot, uint32_t(slot.size() - 1), hole);
+        slot.pop_back();
+        e.wheel_slot = kNoSlot;
+    }
+
+    static void move_record(std::vector<WheelRecord>& slot, uint32_t from, uint32_t to) {
+        if (from == to) return;
+        slot[to] = slot[from];
+        slot[to].item->wheel_pos = to;
     }
 
-private:
     size_t cap_;
+    uint64_t default_ttl_ns_;
+    uint64_t tick_ns_;
     mutable std::shared_mutex m_;
-    std::list<std::pair<K,V>> items_;
-    std::unordered_map<K, typename std::list<std::pair<K,V>>::iterator> map_;
+    std::list<Entry> items_;
+    std::unordered_map<K, ItemIter, Hash, KeyEqual> map_;
+    std::vector<std::vector<WheelRecord>> wheel_;
+    uint64_t wheel_tick_ = 0; // next tick to sweep
+    size_t wheel_pos_ = 0;    // resume position within that tick's slot
+    std::unordered_map<K, Inflight, Hash, KeyEqual> inflight_;
+    RefreshWorker refresher_;
 };
 
-template<typename K, typename V>
+template<typename K, typename V, typename Hash = DefaultHash<K>, typename KeyEqual = DefaultKeyEqual<K>,
+         typename Clock = CoarseTscClock>
 class ShardedLRUCache {
+    using Shard = LRUCacheShard<K, V, Hash, KeyEqual, Clock>;
+
 public:
-    explicit ShardedLRUCache(size_t capacity, size_t shards = 8)
+    explicit ShardedLRUCache(size_t capacity, size_t shards = 8,
+                             std::chrono::nanoseconds default_ttl = std::chrono::nanoseconds(0))
         : shards_(std::max<size_t>(1, shards)) {
         // spread capacity evenly across shards
         size_t per = std::max<size_t>(1, capacity / shards_);
         caches_.reserve(shards_);
-        for (size_t i = 0; i < shards_; ++i) caches_.push_back(std::make_unique<LRUCacheShard<K,V>>(per));
+        for (size_t i = 0; i < shards_; ++i) caches_.push_back(std::make_unique<Shard>(per, default_ttl));
     }
 
+    ~ShardedLRUCache() { stop_sweeper(); }
+
     std::optional<V> get(const K& k) {
         size_t i = shard_for(k);
         return caches_[i]->get(k);
@@ -79,23 +520,144 @@ public:
         caches_[i]->put(k, std::move(v));
     }
 
+    // Heterogeneous lookup, e.g. string_view / const char* on a std::string cache.
+    template<typename Q> requires TransparentKey<Q, K, Hash, KeyEqual>
+    std::optional<V> get(const Q& k) {
+        return caches_[shard_for(k)]->get(k);
+    }
+
+    template<typename Q> requires TransparentKey<Q, K, Hash, KeyEqual>
+    void put(const Q& k, V v) {
+        caches_[shard_for(k)]->put(k, std::move(v));
+    }
+
+    // Read-through with request coalescing; see LRUCacheShard::get_or_load.
+    template<typename Loader>
+    V get_or_load(const K& k, Loader&& loader, LoadOptions opts = {}) {
+        return caches_[shard_for(k)]->get_or_load(k, std::forward<Loader>(loader), opts);
+    }
+
+    // Store with an explicit TTL (0 = never expires). Expired entries are
+    // dropped lazily by get and reclaimed by sweep_expired / the sweeper.
+    template<typename Q> requires std::same_as<Q, K> || TransparentKey<Q, K, Hash, KeyEqual>
+    void put(const Q& k, V v, std::chrono::nanoseconds ttl) {
+        caches_[shard_for(k)]->put(k, std::move(v), ttl);
+    }
+
+    // Look up a batch of keys. out[i] receives the value for keys[i] (or
+    // nullopt). Keys are grouped by shard so each shard lock is taken once
+    // per call rather than once per key.
+    void get_many(std::span<const K> keys, std::span<std::optional<V>> out) {
+        assert(out.size() >= keys.size());
+        const auto& g = group_by_shard(keys);
+        for (size_t s = 0; s < shards_; ++s) {
+            if (g.start[s] == g.start[s + 1]) continue;
+            caches_[s]->get_batch(keys, g.shard_slice(s), out);
+        }
+    }
+
+    // Insert/update a batch; vals[i] is stored under keys[i]. Duplicate keys
+    // within one batch are applied in order, so the last value wins.
+    void put_many(std::span<const K> keys, std::span<const V> vals) {
+        assert(vals.size() >= keys.size());
+        const auto& g = group_by_shard(keys);
+        for (size_t s = 0; s < shards_; ++s) {
+            if (g.start[s] == g.start[s + 1]) continue;
+            caches_[s]->put_batch(keys, vals, g.shard_slice(s));
+        }
+    }
+
     size_t size() const {
         size_t total = 0;
         for (const auto &s : caches_) total += s->size();
         return total;
     }
 
+    size_t wheel_records() const {
+        size_t total = 0;
+        for (const auto &s : caches_) total += s->wheel_records();
+        return total;
+    }
+
+    // One bounded slice of expiry work on every shard; returns entries reclaimed.
+    size_t sweep_expired(size_t budget_per_shard = 256) {
+        size_t n = 0;
+        for (auto &s : caches_) n += s->sweep_expired(budget_per_shard);
+        return n;
+    }
+
+    // Background sweeper: every `interval`, visit each shard's timer wheel
+    // for at most `budget_per_shard` records. The shard lock is taken per
+    // slice, so readers never wait behind a full-cache scan.
+    void start_sweeper(std::chrono::milliseconds interval = std::chrono::milliseconds(10),
+                       size_t budget_per_shard = 256) {
+        if (sweeper_.joinable()) return;
+        sweeper_stop_.store(false, std::memory_order_relaxed);
+        sweeper_ = std::thread([this, interval, budget_per_shard] {
+            while (!sweeper_stop_.load(std::memory_order_acquire)) {
+                sweep_expired(budget_per_shard);
+                std::this_thread::sleep_for(interval);
+            }
+        });
+    }
+
+    void stop_sweeper() {
+        if (!sweeper_.joinable()) return;
+        sweeper_stop_.store(true, std::memory_order_release);
+        sweeper_.join();
+    }
+
 private:
-    size_t shard_for(const K& k) const {
-        return (std::hash<K>{}(k)) % shards_;
+    template<typename Q>
+    size_t shard_for(const Q& k) const {
+        return (Hash{}(k)) % shards_;
+    }
+
+    // Counting sort of batch positions by shard. Scratch space is per thread
+    // and reused across calls so a batch lookup does not allocate in steady
+    // state. Positions keep their original order within each shard.
+    struct ShardGroups {
+        std::vector<uint32_t> shard;  // shard of keys[i]
+        std::vector<uint32_t> start;  // shards_ + 1 offsets into order
+        std::vector<uint32_t> order;  // batch positions grouped by shard
+        std::vector<uint32_t> cursor; // fill position per shard
+
+        std::span<const uint32_t> shard_slice(size_t s) const {
+            return std::span<const uint32_t>(order).subspan(start[s], start[s + 1] - start[s]);
+        }
+    };
+
+    const ShardGroups& group_by_shard(std::span<const K> keys) const {
+        thread_local ShardGroups g;
+        const size_t n = keys.size();
+        g.shard.resize(n);
+        g.order.resize(n);
+        g.start.assign(shards_ + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            g.shard[i] = uint32_t(shard_for(keys[i]));
+            ++g.start[g.shard[i] + 1];
+        }
+        for (size_t s = 0; s < shards_; ++s) g.start[s + 1] += g.start[s];
+        g.cursor.assign(g.start.begin(), g.start.end() - 1);
+        for (size_t i = 0; i < n; ++i) g.order[g.cursor[g.shard[i]]++] = uint32_t(i);
+        return g;
     }
 
     size_t shards_;
-    std::vector<std::unique_ptr<LRUCacheShard<K,V>>> caches_;
+    std::vector<std::unique_ptr<Shard>> caches_;
+    std::thread sweeper_;
+    std::atomic<bool> sweeper_stop_{false};
 };
 
 // Simple tests
 #ifndef LRU_BENCH
+// Test clock: time only moves when the test advances it.
+struct ManualClock {
+    static inline std::atomic<uint64_t> t{1'000'000'000};
+    static uint64_t now_ns() { return t.load(std::memory_order_relaxed); }
+    static void advance(std::chrono::nanoseconds d) { t.fetch_add(uint64_t(d.count()), std::memory_order_relaxed); }
+};
+
 int main() {
     ShardedLRUCache<int,int> c(2, 2); // capacity=2, shards=2
     c.put(1,1);
@@ -106,6 +668,138 @@ int main() {
     auto r2 = c.get(2);
     // depending on sharding, item 2 may be evicted from its shard; check size semantics
     if (c.size() > 2) { std::cerr << "lru size fail\n"; return 3; }
+
+    // batch API: grouped per shard, results land in caller order
+    ShardedLRUCache<int,int> b(64, 4);
+    std::vector<int> keys{5, 9, 5, 2, 13, 7};
+    std::vector<int> vals{50, 90, 55, 20, 130, 70};
+    b.put_many(keys, vals);
+    std::vector<int> probe{2, 5, 99, 13, 9, 7};
+    std::vector<std::optional<int>> got(probe.size());
+    b.get_many(probe, got);
+    const std::optional<int> want[] = {20, 55, std::nullopt, 130, 90, 70};
+    for (size_t i = 0; i < probe.size(); ++i) {
+        if (got[i] != want[i]) { std::cerr << "lru get_many fail at " << i << "\n"; return 4; }
+    }
+    if (b.size() != 5) { std::cerr << "lru put_many size fail\n"; return 5; }
+
+    // string keys: string_view / const char* probe without building a std::string
+    ShardedLRUCache<std::string,double> px(16, 4);
+    px.put(std::string("AAPL"), 189.5);
+    std::string_view wire = "MSFT,411.2";
+    px.put(wire.substr(0, 4), 411.2);
+    auto a = px.get("AAPL");
+    auto m = px.get(wire.substr(0, 4));
+    if (!a || *a != 189.5 || !m || *m != 411.2 || px.get(std::string_view("MSF"))) {
+        std::cerr << "lru transparent lookup fail\n"; return 6;
+    }
+
+    // inline 16-byte symbols
+    ShardedLRUCache<InlineSymbol,int> sym(16, 2);
+    sym.put(InlineSymbol("ESZ6"), 1);
+    sym.put(InlineSymbol("ESH7-ESZ6-SPRD"), 2);
+    auto s1 = sym.get(InlineSymbol(std::string_view("ESZ6")));
+    auto s2 = sym.get(InlineSymbol("ESH7-ESZ6-SPRD"));
+    if (!s1 || *s1 != 1 || !s2 || *s2 != 2 || sym.get(InlineSymbol("ESZ")) || InlineSymbol("ESZ6").view() != "ESZ6") {
+        std::cerr << "lru inline symbol fail\n"; return 7;
+    }
+
+    // TTL: lazy expiry on get, wheel sweep reclaims untouched entries
+    using namespace std::chrono_literals;
+    using TtlCache = ShardedLRUCache<int,int,DefaultHash<int>,DefaultKeyEqual<int>,ManualClock>;
+    TtlCache ttl(64, 2, 20ms);
+    ttl.put(1, 10);             // default TTL
+    ttl.put(2, 20, 0ns);        // never expires
+    ttl.put(3, 30, 1h);
+    ttl.put(4, 40, 5ms);
+    ManualClock::advance(4ms);
+    if (!ttl.get(1) || !ttl.get(4)) { std::cerr << "lru ttl early expiry\n"; return 8; }
+    ManualClock::advance(30ms);
+    if (ttl.get(1) || !ttl.get(2) || !ttl.get(3)) { std::cerr << "lru ttl lazy expiry fail\n"; return 9; }
+    for (int k = 10; k < 20; ++k) ttl.put(k, k, 5ms);
+    ManualClock::advance(20ms);
+    size_t swept = 0;
+    for (int i = 0; i < 8; ++i) swept += ttl.sweep_expired(4); // bounded slices resume where they stopped
+    if (swept != 11 || ttl.size() != 2 || ttl.wheel_records() != 1) {
+        std::cerr << "lru ttl sweep fail: swept=" << swept << " size=" << ttl.size() << "\n"; return 10;
+    }
+    ttl.put(5, 50, 5ms);
+    ttl.put(5, 51);             // re-put with the default TTL moves the wheel record
+    ManualClock::advance(12ms);
+    ttl.sweep_expired();
+    if (!ttl.get(5)) { std::cerr << "lru ttl re-put fail\n"; return 11; }
+
+    // a hot key re-put many times, and evicted entries, leave no records behind
+    TtlCache bounded(8, 1);
+    for (int i = 0; i < 10000; ++i) bounded.put(7, i, 1h + std::chrono::nanoseconds(i));
+    for (int k = 100; k < 200; ++k) bounded.put(k, k, 1h);
+    if (bounded.size() != 8 || bounded.wheel_records() != 8) {
+        std::cerr << "lru ttl wheel growth: records=" << bounded.wheel_records() << "\n"; return 17;
+    }
+
+    // the same expiry behaviour on the default TSC clock
+    ShardedLRUCache<int,int> tsc(16, 2);
+    tsc.put(1, 10, 1h);
+    tsc.put(2, 20, 1ms);
+    std::this_thread::sleep_for(5ms);
+    if (!tsc.get(1) || tsc.get(2) || tsc.size() != 1) { std::cerr << "lru tsc clock ttl fail\n"; return 20; }
+
+    // the background sweeper reclaims without any get()
+    bounded.start_sweeper(1ms, 4);
+    ManualClock::advance(2h);
+    for (int i = 0; i < 2000 && bounded.size(); ++i) std::this_thread::sleep_for(1ms);
+    bounded.stop_sweeper();
+    if (bounded.size() != 0 || bounded.wheel_records() != 0) { std::cerr << "lru ttl sweeper fail\n"; return 18; }
+
+    // single-flight: concurrent missers share one loader call
+    ShardedLRUCache<std::string,int,DefaultHash<std::string>,DefaultKeyEqual<std::string>,ManualClock> sf(64, 4, 60ms);
+    std::atomic<int> loads{0};
+    auto slow_loader = [&](const std::string& key) {
+        loads.fetch_add(1);
+        std::this_thread::sleep_for(20ms);
+        return int(key.size());
+    };
+    std::vector<std::thread> ths;
+    std::atomic<int> wrong{0};
+    for (int t = 0; t < 8; ++t) {
+        ths.emplace_back([&] { if (sf.get_or_load("ESZ6", slow_loader) != 4) wrong.fetch_add(1); });
+    }
+    for (auto &t : ths) t.join();
+    if (loads.load() != 1 || wrong.load() != 0) { std::cerr << "lru single-flight fail: loads=" << loads.load() << "\n"; return 12; }
+
+    // loader failure reaches the caller and is not cached
+    bool threw = false;
+    try { sf.get_or_load("bad", [](const std::string&) -> int { throw std::runtime_error("backend down"); }); }
+    catch (const std::runtime_error&) { threw = true; }
+    if (!threw || sf.get("bad")) { std::cerr << "lru loader exception fail\n"; return 13; }
+
+    // a put() while the loader runs is not overwritten by the older load
+    std::promise<void> entered, release;
+    std::shared_future<void> go = release.get_future().share();
+    std::thread racer([&] {
+        sf.get_or_load("RTYZ6", [&](const std::string&) { entered.set_value(); go.wait(); return 1; });
+    });
+    entered.get_future().wait();
+    sf.put(std::string("RTYZ6"), 2);
+    release.set_value();
+    racer.join();
+    auto raced = sf.get("RTYZ6");
+    if (!raced || *raced != 2) { std::cerr << "lru load overwrote put\n"; return 19; }
+
+    // refresh-ahead: near expiry the stale value is served while the shard's
+    // refresh thread reloads it. The loader owns its state (it is copied).
+    auto version = std::make_shared<std::atomic<int>>(0);
+    auto versioned = [version](const std::string&) { return version->fetch_add(1) + 1; };
+    LoadOptions ra{.ttl = 50ms, .refresh_ahead = 40ms};
+    if (sf.get_or_load("NQZ6", versioned, ra) != 1) { std::cerr << "lru refresh initial fail\n"; return 14; }
+    ManualClock::advance(20ms);
+    if (sf.get_or_load("NQZ6", versioned, ra) != 1) { std::cerr << "lru refresh stale fail\n"; return 15; }
+    std::optional<int> refreshed;
+    for (int i = 0; i < 2000 && (!refreshed || *refreshed != 2); ++i) {
+        std::this_thread::sleep_for(1ms);
+        refreshed = sf.get("NQZ6");
+    }
+    if (!refreshed || *refreshed != 2 || version->load() != 2) { std::cerr << "lru refresh-ahead fail\n"; return 16; }
     std::cout << "lru_cache (sharded): PASS\n";
     return 0;
 }
@@ -16,23 +16,52 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 // ------------------------- Hazard Pointers -------------------------
 namespace hp {
     constexpr int MAX_THREADS = 128;
-    // one hazard pointer slot per thread for simplicity
-    static std::atomic<void*> hazard_ptrs[MAX_THREADS];
+    // a list traversal protects prev, cur and one extra node (e.g. the
+    // eviction candidate), so each thread owns SLOTS hazard pointers
+    constexpr int SLOTS = 3;
+    static std::atomic<void*> hazard_ptrs[MAX_THREADS * SLOTS];
     static std::atomic<int> next_slot{0};
 
     thread_local int my_slot = -1;
-    thread_local std::vector<void*> retire_list;
+
+    // Nodes that are not protected by any hazard pointer are freed.
+    inline void scan(std::vector<std::pair<void*, void(*)(void*)>>& retired) {
+        std::vector<void*> hazards;
+        hazards.reserve(MAX_THREADS * SLOTS);
+        for (int i = 0; i < MAX_THREADS * SLOTS; ++i) {
+            void* v = hazard_ptrs[i].load(std::memory_order_seq_cst);
+            if (v) hazards.push_back(v);
+        }
+        std::vector<std::pair<void*, void(*)(void*)>> remaining;
+        for (auto r : retired) {
+            bool in_use = false;
+            for (void* h : hazards) if (h == r.first) { in_use = true; break; }
+            if (in_use) remaining.push_back(r);
+            else r.second(r.first);
+        }
+        retired.swap(remaining);
+    }
+
+    // A thread's retired nodes; whatever is unprotected when the thread
+    // exits is freed then (nodes still protected at that point are leaked).
+    struct RetireList {
+        std::vector<std::pair<void*, void(*)(void*)>> nodes;
+        ~RetireList() { scan(nodes); }
+    };
+    thread_local RetireList retire_list;
 
     int alloc_slot() {
         int s = next_slot.fetch_add(1, std::memory_order_relaxed);
@@ -45,57 +74,55 @@ namespace hp {
 
     // initialize hazard array to null pointers
     inline void init() {
-        for (int i = 0; i < MAX_THREADS; ++i) hazard_ptrs[i].store(nullptr, std::memory_order_relaxed);
+        for (int i = 0; i < MAX_THREADS * SLOTS; ++i) hazard_ptrs[i].store(nullptr, std::memory_order_relaxed);
     }
 
+    // Hazard pointer `idx` (0..SLOTS-1) of the calling thread.
     struct Guard {
-        Guard(void* p = nullptr) {
+        explicit Guard(int idx, void* p = nullptr) {
             if (my_slot == -1) my_slot = alloc_slot();
+            slot_ = &hazard_ptrs[my_slot * SLOTS + idx];
             set(p);
         }
-        void set(void* p) { hazard_ptrs[my_slot].store(p, std::memory_order_release); }
-        void clear() { hazard_ptrs[my_slot].store(nullptr, std::memory_order_release); }
+        void set(void* p) { slot_->store(p, std::memory_order_seq_cst); }
+        void clear() { slot_->store(nullptr, std::memory_order_release); }
         ~Guard() { clear(); }
+
+    private:
+        std::atomic<void*>* slot_;
     };
 
-    void retire(void* p, std::function<void(void*)> deleter) {
+    // The deleter is kept per node, so caches of different node types can
+    // share a thread's retire list.
+    void retire(void* p, void (*deleter)(void*)) {
         if (my_slot == -1) my_slot = alloc_slot();
-        retire_list.push_back(p);
+        retire_list.nodes.emplace_back(p, deleter);
         const size_t THRESH = 64;
-        if (retire_list.size() >= THRESH) {
-            // collect hazard pointers snapshot
-            std::vector<void*> hazards;
-            hazards.reserve(MAX_THREADS);
-            for (int i = 0; i < MAX_THREADS; ++i) {
-                void* v = hazard_ptrs[i].load(std::memory_order_acquire);
-                if (v) hazards.push_back(v);
-            }
-            // try to reclaim
-            std::vector<void*> remaining;
-            for (void* r : retire_list) {
-                bool in_use = false;
-                for (void* h : hazards) if (h == r) { in_use = true; break; }
-                if (in_use) remaining.push_back(r);
-                else deleter(r);
-            }
-            retire_list.swap(remaining);
-        }
+        if (retire_list.nodes.size() >= THRESH) scan(retire_list.nodes);
     }
 }
 
 // ------------------- LockFreeLRU using Hazard Pointers -------------------
+// Buckets are Harris/Michael lists: a node is deleted by setting the low
+// bit of its next pointer, and any traversal that meets a marked node
+// unlinks it with a CAS on the predecessor's link and retires it. So
+// evicted nodes leave the bucket chains, wherever they sit in them.
 template<typename K, typename V>
 class LockFreeLRU_HazardPointers {
     struct Node {
         K key;
         V value;
-        std::atomic<Node*> next;
-        std::atomic<bool> deleted;
-        uint64_t timestamp;
+        std::atomic<Node*> next; // low bit set: this node is deleted
+        std::atomic<uint64_t> timestamp;
         Node(const K& k, const V& v, Node* n)
-            : key(k), value(v), next(n), deleted(false), timestamp(0) {}
+            : key(k), value(v), next(n), timestamp(0) {}
     };
 
+    static bool marked(Node* p) { return reinterpret_cast<uintptr_t>(p) & 1; }
+    static Node* mark(Node* p) { return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(p) | 1); }
+    static Node* unmark(Node* p) { return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(1)); }
+    static void delete_node(void* p) { delete static_cast<Node*>(p); }
+
 public:
     explicit LockFreeLRU_HazardPointers(size_t buckets = 64, size_t capacity = 1024)
         : buckets_(buckets), capacity_(capacity), size_(0) {
@@ -107,48 +134,25 @@ public:
     ~LockFreeLRU_HazardPointers() {
         for (size_t i = 0; i < buckets_; ++i) {
             Node* p = heads_[i].load(std::memory_order_relaxed);
-            while (p) { Node* n = p->next.load(std::memory_order_relaxed); delete p; p = n; }
+            while (p) { Node* n = unmark(p->next.load(std::memory_order_relaxed)); delete p; p = n; }
         }
     }
 
     std::optional<V> get(const K& k) {
-        size_t i = bucket(k);
-        // traverse lock-free with hazard pointer guard
-        Node* cur = heads_[i].load(std::memory_order_acquire);
-        while (cur) {
-            hp::Guard gcur((void*)cur);
-            // ensure head hasn't changed to avoid guarding a stale pointer
-            if (heads_[i].load(std::memory_order_acquire) != cur) {
-                cur = heads_[i].load(std::memory_order_acquire);
-                continue;
-            }
-            // check deleted
-            if (cur->deleted.load(std::memory_order_acquire)) {
-                cur = cur->next.load(std::memory_order_acquire);
-                continue;
-            }
-            if (cur->key == k) {
-                cur->timestamp = timestamp_now();
-                return cur->value;
-            }
-            // Move to next safely: read next, set hazard, verify
-            Node* next = cur->next.load(std::memory_order_acquire);
-            if (!next) break;
-            hp::Guard gnext((void*)next);
-            if (cur->next.load(std::memory_order_acquire) != next) {
-                // link changed; retry from current head
-                cur = heads_[i].load(std::memory_order_acquire);
-                continue;
-            }
-            cur = next;
-        }
-        return std::nullopt;
+        std::optional<V> out;
+        walk(bucket(k), [&](Node* n) {
+            if (n->key != k) return false;
+            n->timestamp.store(timestamp_now(), std::memory_order_relaxed);
+            out = n->value;
+            return true;
+        });
+        return out;
     }
 
     void put(const K& k, V v) {
         size_t i = bucket(k);
         Node* newn = new Node(k, v, nullptr);
-        newn->timestamp = timestamp_now();
+        newn->timestamp.store(timestamp_now(), std::memory_order_relaxed);
         for (;;) {
             Node* head = heads_[i].load(std::memory_order_acquire);
             newn->next.store(head, std::memory_order_relaxed);
@@ -161,6 +165,7 @@ public:
         if (size_.load(std::memory_order_relaxed) > capacity_) compact(i);
     }
 
+    // Live (unmarked) nodes, including older duplicates of a re-put key.
     size_t size() const { return size_.load(); }
 
 private:
@@ -168,62 +173,58 @@ private:
 
     uint64_t timestamp_now() const { return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count(); }
 
-    void compact(size_t i) {
-        // simple compaction: remove nodes with oldest timestamps (single-pass)
-    Node* prev = nullptr;
-    Node* cur = heads_[i].load(std::memory_order_acquire);
-        uint64_t oldest = UINT64_MAX;
-        Node* oldest_node = nullptr;
-        Node* oldest_prev = nullptr;
-        Node* node = cur;
-        // traverse with hazard-pointer guards to avoid accessing reclaimed nodes
-        while (node) {
-            hp::Guard gnode((void*)node);
-            // ensure head hasn't changed to avoid guarding a stale pointer
-            if (heads_[i].load(std::memory_order_acquire) != node) {
-                // restart traversal from fresh head
-                prev = nullptr;
-                cur = heads_[i].load(std::memory_order_acquire);
-                node = cur;
-                oldest = UINT64_MAX; oldest_node = nullptr; oldest_prev = nullptr;
-                continue;
-            }
-            // read fields while guarded
-            if (!node->deleted.load(std::memory_order_acquire)) {
-                uint64_t t = node->timestamp;
-                if (t < oldest) { oldest = t; oldest_node = node; oldest_prev = prev; }
-            }
-            // prepare next safely
-            Node* next = node->next.load(std::memory_order_acquire);
-            if (!next) break;
-            hp::Guard gnext((void*)next);
-            if (node->next.load(std::memory_order_acquire) != next) {
-                // list changed; restart from head
-                prev = nullptr;
-                node = heads_[i].load(std::memory_order_acquire);
+    // Visit the live nodes of bucket i in order, unlinking marked nodes on
+    // the way, until visit(node) returns true. The visited node is protected
+    // by hazard pointer 0 for the duration of the call. Returns false if the
+    // end of the list was reached.
+    template<typename Visit>
+    bool walk(size_t i, Visit&& visit) {
+        hp::Guard hcur(0), hprev(1);
+    retry:
+        std::atomic<Node*>* prev = &heads_[i];
+        Node* cur = prev->load(std::memory_order_acquire);
+        while (cur) {
+            hcur.set(cur);
+            // cur is safe to dereference only if it is still linked from prev;
+            // a marked prev node would fail this check too
+            if (prev->load(std::memory_order_acquire) != cur) goto retry;
+            Node* next = cur->next.load(std::memory_order_acquire);
+            if (marked(next)) {
+                Node* expected = cur;
+                if (!prev->compare_exchange_strong(expected, unmark(next), std::memory_order_acq_rel))
+                    goto retry;
+                hp::retire(cur, &delete_node);
+                cur = unmark(next);
                 continue;
             }
-            prev = node;
-            node = next;
+            if (visit(cur)) return true;
+            hprev.set(cur); // cur now owns the link we read next from
+            prev = &cur->next;
+            cur = next;
         }
+        return false;
+    }
+
+    void compact(size_t i) {
+        // simple compaction: evict the node with the oldest timestamp
+        // (single pass); the candidate stays protected by hazard pointer 2
+        hp::Guard holdest(2);
+        uint64_t oldest = UINT64_MAX;
+        Node* oldest_node = nullptr;
+        walk(i, [&](Node* n) {
+            uint64_t t = n->timestamp.load(std::memory_order_relaxed);
+            if (t < oldest) { oldest = t; oldest_node = n; holdest.set(n); }
+            return false;
+        });
         if (!oldest_node) return;
-    // logically delete
-    bool expected = false;
-    if (!oldest_node->deleted.compare_exchange_strong(expected, true)) return;
-        // physically unlink by CAS on head if it's the head, else perform a best-effort unlink
-        if (oldest_prev == nullptr) {
-            // head: try to unlink safely
-            Node* cur_head = heads_[i].load(std::memory_order_acquire);
-            Node* next = oldest_node->next.load(std::memory_order_acquire);
-            heads_[i].compare_exchange_strong(cur_head, next, std::memory_order_acq_rel);
-        } else {
-            // Non-head unlink is unsafe in this simple example because 'oldest_prev'
-            // may have been concurrently removed; to avoid unsafe memory access,
-            // we only logical-delete here and leave physical unlinking to helpers.
-        }
+        // logically delete: whoever sets the mark owns the size decrement
+        Node* next = oldest_node->next.load(std::memory_order_acquire);
+        do {
+            if (marked(next)) return;
+        } while (!oldest_node->next.compare_exchange_weak(next, mark(next), std::memory_order_acq_rel));
         size_.fetch_sub(1, std::memory_order_relaxed);
-        // retire memory via hazard-pointer retire
-        hp::retire((void*)oldest_node, [](void* p){ delete static_cast<Node*>(p); });
+        // physically unlink it (and any other marked node) before returning
+        walk(i, [](Node*) { return false; });
     }
 
     size_t buckets_;
@@ -10,6 +10,8 @@ g++ -std=gnu++23 -O2 lru_cache.cpp -o lru_cache
 g++ -std=gnu++23 -O2 slab_allocator.cpp -o slab_allocator
 g++ -std=gnu++23 -O2 radix_sort.cpp -o radix_sort
 g++ -std=gnu++23 -O2 csv_parser.cpp -o csv_parser
+g++ -std=gnu++23 -O2 async_log_test.cpp -o async_log_test
+g++ -std=gnu++23 -O2 -I.. feed_arbiter_test.cpp -o feed_arbiter_test
 echo "Running tests..."
 ./spsc_ring
 ./token_bucket
@@ -19,4 +21,6 @@ echo "Running tests..."
 ./slab_allocator
 ./radix_sort
 ./csv_parser
+./async_log_test
+./feed_arbiter_test
 echo "All temp tests passed"
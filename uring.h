@@ -0,0 +1,149 @@
+#pragma once
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+// Minimal io_uring wrapper on the raw syscalls (no liburing dependency).
+// - One submitter thread per ring; SQ/CQ heads and tails are shared with the
+//   kernel and accessed with acquire/release ordering via std::atomic_ref.
+// - Only what the benchmarks need: SQE allocation, submit+wait, CQE reaping
+//   and buffer/file registration.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring() { close(); }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Returns 0 on success or -errno.
+    int init(unsigned entries, unsigned flags = 0)
+    {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        p.flags = flags;
+        int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) return -errno;
+        ring_fd_ = fd;
+
+        sq_ring_sz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_sz_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap_) {
+            if (cq_ring_sz_ > sq_ring_sz_) sq_ring_sz_ = cq_ring_sz_;
+            cq_ring_sz_ = sq_ring_sz_;
+        }
+
+        sq_ptr_ = mmap(nullptr, sq_ring_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; int e = errno; close(); return -e; }
+        if (single_mmap_) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_ring_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; int e = errno; close(); return -e; }
+        }
+        sqes_sz_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe*)mmap(nullptr, sqes_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) { sqes_ = nullptr; int e = errno; close(); return -e; }
+
+        char* sq = (char*)sq_ptr_;
+        sq_head_ = (unsigned*)(sq + p.sq_off.head);
+        sq_tail_ = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        sq_array_ = (unsigned*)(sq + p.sq_off.array);
+        char* cq = (char*)cq_ptr_;
+        cq_head_ = (unsigned*)(cq + p.cq_off.head);
+        cq_tail_ = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+        sqe_tail_ = sqe_head_ = *sq_tail_;
+        return 0;
+    }
+
+    void close()
+    {
+        if (sqes_) munmap(sqes_, sqes_sz_);
+        if (cq_ptr_ && !single_mmap_) munmap(cq_ptr_, cq_ring_sz_);
+        if (sq_ptr_) munmap(sq_ptr_, sq_ring_sz_);
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+        sqes_ = nullptr; cq_ptr_ = nullptr; sq_ptr_ = nullptr; ring_fd_ = -1;
+    }
+
+    // Next free SQE (zeroed) or nullptr if the SQ ring is full.
+    io_uring_sqe* get_sqe()
+    {
+        unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        if (sqe_tail_ - head >= sq_entries_) return nullptr;
+        unsigned idx = sqe_tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[idx] = idx;
+        ++sqe_tail_;
+        return sqe;
+    }
+
+    // Publish pending SQEs and enter the kernel, waiting for at least
+    // `wait_nr` completions. Returns the number submitted or -errno.
+    int submit_and_wait(unsigned wait_nr)
+    {
+        unsigned to_submit = sqe_tail_ - sqe_head_;
+        std::atomic_ref<unsigned>(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+        sqe_head_ = sqe_tail_;
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        int ret = (int)syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags, nullptr, 0);
+        return ret < 0 ? -errno : ret;
+    }
+
+    // Oldest unreaped completion or nullptr; call cqe_seen() after using it.
+    io_uring_cqe* peek_cqe()
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        if (head == tail) return nullptr;
+        return &cqes_[head & cq_mask_];
+    }
+
+    void cqe_seen()
+    {
+        std::atomic_ref<unsigned>(*cq_head_).store(*cq_head_ + 1, std::memory_order_release);
+    }
+
+    int register_buffers(const iovec* iovs, unsigned nr) { return reg(IORING_REGISTER_BUFFERS, iovs, nr); }
+    int register_files(const int* fds, unsigned nr) { return reg(IORING_REGISTER_FILES, fds, nr); }
+
+private:
+    int reg(unsigned opcode, const void* arg, unsigned nr)
+    {
+        int ret = (int)syscall(__NR_io_uring_register, ring_fd_, opcode, arg, nr);
+        return ret < 0 ? -errno : 0;
+    }
+
+    int ring_fd_ = -1;
+    bool single_mmap_ = false;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_ring_sz_ = 0;
+    size_t cq_ring_sz_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_sz_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_head_ = 0; // first SQE not yet published to the kernel
+    unsigned sqe_tail_ = 0; // next SQE to hand out
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};